@@ -0,0 +1,22 @@
+// include/crypto/bitmatrix.hpp
+//
+// Bit-matrix helpers shared by the bitsliced cipher and the diffusion tool.
+
+#pragma once
+#include <cstdint>
+
+namespace crypto {
+
+// 64x64 bit-matrix transpose in place; bit (63-c) of a[r] moves to bit (63-r) of a[c]
+inline void transpose64(uint64_t a[64]) {
+    uint64_t m = 0x00000000FFFFFFFFULL;
+    for (int j = 32; j; j >>= 1, m ^= m << j) {
+        for (int k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+            uint64_t t = (a[k] ^ (a[k | j] >> j)) & m;
+            a[k] ^= t;
+            a[k | j] ^= t << j;
+        }
+    }
+}
+
+} // namespace crypto
@@ -6,4 +6,8 @@
 namespace crypto {
     std::string caesar_encrypt(const std::string& s, int shift);
     std::string caesar_decrypt(const std::string& s, int shift);
+
+    // Write into out; its capacity is kept, so reusing out across calls does not allocate
+    void caesar_encrypt(const std::string& s, int shift, std::string& out);
+    void caesar_decrypt(const std::string& s, int shift, std::string& out);
 } // namespace crypto
\ No newline at end of file
@@ -1,7 +1,9 @@
 // include/crypto/clefia.hpp
 
 #pragma once
+#include "crypto/workspace.hpp"
 #include <array>
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -20,6 +22,9 @@ public:
     void encryptBlock(const Block& in, Block& out) const;
     void decryptBlock(const Block& in, Block& out) const;
 
+    // Reduced-round variant (1..18 rounds of GFN4,r with full whitening), for diffusion analysis
+    void encryptBlockRounds(const Block& in, Block& out, int rounds) const;
+
     // CBC with PKCS#7
     static void cbc_encrypt_file(const std::string& in_path,
                                  const std::string& out_path,
@@ -30,7 +35,22 @@ public:
                                  const Key& key,
                                  const Block& iv);
 
+    // Same, streamed through ws in ws.chunk() pieces: memory use does not depend
+    // on the file size and repeated calls with one Workspace allocate nothing
+    static void cbc_encrypt_file(const std::string& in_path,
+                                 const std::string& out_path,
+                                 const Key& key,
+                                 const Block& iv,
+                                 Workspace& ws);
+    static void cbc_decrypt_file(const std::string& in_path,
+                                 const std::string& out_path,
+                                 const Key& key,
+                                 const Block& iv,
+                                 Workspace& ws);
+
 private:
+    friend class Clefia128Bitsliced;   // reuses CON128 and Sigma of the key schedule
+
     std::array<uint32_t, 4> WK{};      // whitening keys
     std::array<uint32_t, 36> RK{};     // round keys (18*2 words)
     static uint32_t load_be32(const uint8_t* p);
@@ -47,9 +67,27 @@ private:
     static void GFN4r_decrypt(const std::array<uint32_t,36>& rk, int r,
                               uint32_t& X0, uint32_t& X1, uint32_t& X2, uint32_t& X3);
 
+    static const uint32_t CON128[60];  // key schedule constants (RFC 6114)
     static void sigma_doubleswap(std::array<uint8_t,16>& L);
     static void expand_key_128(const Key& key, std::array<uint32_t,4>& WK,
                                std::array<uint32_t,36>& RK);
 };
 
+// CTR keystream over CLEFIA-128: counter starts at IV and is incremented
+// as a 128-bit big-endian integer. Encryption and decryption are the same
+// operation, so the object can be fed consecutive chunks of a stream.
+class Clefia128Ctr {
+public:
+    Clefia128Ctr(const Clefia128::Key& key, const Clefia128::Block& iv);
+
+    // XOR keystream into buf[0..n) in place
+    void apply(uint8_t* buf, size_t n);
+
+private:
+    Clefia128 cipher;
+    Clefia128::Block ctr{};
+    Clefia128::Block ks{};
+    size_t used = 16; // consumed bytes of ks
+};
+
 } // namespace crypto
@@ -0,0 +1,34 @@
+// include/crypto/clefia_bitslice.hpp
+//
+// Bitsliced CLEFIA-128 for bulk ECB/CTR work: 256 blocks are transposed into
+// 128 slices of 256 bits (one bit per block) and processed together.
+// S0/S1 are Boolean circuits and M0/M1 XOR networks, so there are no table
+// lookups and no secret-dependent branches or addresses.
+
+#pragma once
+#include "crypto/clefia.hpp"
+
+namespace crypto {
+
+class Clefia128Bitsliced {
+public:
+    static constexpr size_t kLanes = 256;
+
+    Clefia128Bitsliced() = default;
+    explicit Clefia128Bitsliced(const Clefia128::Key& k) { setKey(k); }
+    void setKey(const Clefia128::Key& k);
+
+    // ECB over n consecutive 16-byte blocks, kLanes per pass (a short tail costs
+    // a full pass); in and out may be the same buffer
+    void encryptBlocks(const uint8_t* in, uint8_t* out, size_t n) const;
+    void decryptBlocks(const uint8_t* in, uint8_t* out, size_t n) const;
+
+private:
+    // Key words expanded to all-zero / all-one slices, bit q of the word at [q]
+    std::array<std::array<uint64_t,32>, 4>  WK{};
+    std::array<std::array<uint64_t,32>, 36> RK{};
+
+    void process(const uint8_t* in, uint8_t* out, size_t n, bool decrypt) const;
+};
+
+} // namespace crypto
@@ -9,8 +9,22 @@ namespace crypto {
 
 std::array<uint8_t,16> clefia128_dm_hash(const std::vector<uint8_t>& msg);
 
+// Incremental DM hash: same digest as clefia128_dm_hash over the concatenated input
+class Clefia128DmHasher {
+public:
+    void update(const uint8_t* data, size_t n);
+    std::array<uint8_t,16> final(); // pads and returns digest; hasher is reset
+private:
+    void compress(const uint8_t* block);
+    std::array<uint8_t,16> H{};      // chaining value, H0 = 0^128
+    std::array<uint8_t,16> buf{};    // partial block
+    size_t used = 0;
+};
+
 // helper to hex
 std::string to_hex(const std::array<uint8_t,16>& d);
+// writes 32 lowercase hex chars to out (no terminator, no allocation)
+void to_hex(const std::array<uint8_t,16>& d, char* out);
 
 // Avalanche test helper: returns fraction of differing bits
 double hamming_fraction(const std::array<uint8_t,16>& a,
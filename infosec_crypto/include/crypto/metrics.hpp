@@ -0,0 +1,77 @@
+// include/crypto/metrics.hpp
+//
+// Optional hot-path instrumentation. Build with -DCRYPTO_INSTRUMENT to enable;
+// otherwise CRYPTO_COUNT / CRYPTO_TIME expand to nothing and snapshots are empty.
+// Counters live in per-thread slots (single writer, relaxed atomics), so the
+// hot path takes no locks; snapshot() sums all slots.
+
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace crypto {
+namespace metrics {
+
+enum Counter : int {
+    BlocksEncrypted,
+    BlocksDecrypted,
+    KeySchedules,
+    BytesHashed,
+    IoBytesRead,
+    IoBytesWritten,
+    kCounterCount
+};
+
+enum Timer : int {
+    CbcEncryptFile,
+    CbcDecryptFile,
+    Hash,
+    kTimerCount
+};
+
+// Latency histogram: bucket b counts durations in [2^(b-1), 2^b) ns, last bucket is open
+constexpr int kBuckets = 40;
+
+struct Snapshot {
+    uint64_t counters[kCounterCount] = {};
+    uint64_t buckets[kTimerCount][kBuckets] = {};
+    uint64_t count[kTimerCount] = {};
+    uint64_t sum_ns[kTimerCount] = {};
+};
+
+#ifdef CRYPTO_INSTRUMENT
+constexpr bool enabled = true;
+#else
+constexpr bool enabled = false;
+#endif
+
+void add(Counter c, uint64_t n);
+void record(Timer t, uint64_t ns);
+
+Snapshot snapshot();
+std::string to_prometheus(const Snapshot& s);
+std::string to_json(const Snapshot& s);
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Timer t);
+    ~ScopedTimer();
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+private:
+    Timer timer;
+    uint64_t start_ns;
+};
+
+} // namespace metrics
+} // namespace crypto
+
+#ifdef CRYPTO_INSTRUMENT
+#define CRYPTO_METRICS_CAT2(a, b) a##b
+#define CRYPTO_METRICS_CAT(a, b) CRYPTO_METRICS_CAT2(a, b)
+#define CRYPTO_COUNT(c, n) ::crypto::metrics::add(::crypto::metrics::c, (n))
+#define CRYPTO_TIME(t) ::crypto::metrics::ScopedTimer CRYPTO_METRICS_CAT(crypto_timer_, __LINE__)(::crypto::metrics::t)
+#else
+#define CRYPTO_COUNT(c, n) ((void)0)
+#define CRYPTO_TIME(t) ((void)0)
+#endif
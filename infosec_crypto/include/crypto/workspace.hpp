@@ -0,0 +1,31 @@
+// include/crypto/workspace.hpp
+//
+// Reusable scratch memory for the streaming file APIs. The buffer is allocated
+// once in the constructor; calls that take a Workspace work inside it, so a
+// caller that keeps one Workspace per thread makes no heap allocations per
+// operation. Not thread-safe: use one Workspace per thread.
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace crypto {
+
+class Workspace {
+public:
+    static constexpr size_t kDefaultChunk = 64 * 1024;
+
+    // chunk is rounded down to whole 16-byte blocks (at least one)
+    explicit Workspace(size_t chunk = kDefaultChunk)
+        : chunk_(chunk < 16 ? 16 : chunk & ~size_t(15)), buf_(chunk_) {}
+
+    size_t chunk() const { return chunk_; }
+    uint8_t* io() { return buf_.data(); } // chunk() bytes
+
+private:
+    size_t chunk_;
+    std::vector<uint8_t> buf_;
+};
+
+} // namespace crypto
@@ -11,16 +11,25 @@ static char rot_letter(char c, int shift, char base) {
     return static_cast<char>(base + m);
 }
 
-std::string caesar_encrypt(const std::string& s, int shift) {
-    std::string out; out.reserve(s.size());
-    for (unsigned char ch : s) {
+void caesar_encrypt(const std::string& s, int shift, std::string& out) {
+    out.resize(s.size());
+    for (size_t i=0;i<s.size();i++) {
+        unsigned char ch = static_cast<unsigned char>(s[i]);
         if (std::isalpha(ch)) {
-            if (std::isupper(ch)) out.push_back(rot_letter(ch, shift, 'A'));
-            else out.push_back(rot_letter(ch, shift, 'a'));
+            out[i] = std::isupper(ch) ? rot_letter(ch, shift, 'A') : rot_letter(ch, shift, 'a');
         } else {
-            out.push_back(ch);
+            out[i] = static_cast<char>(ch);
         }
     }
+}
+
+void caesar_decrypt(const std::string& s, int shift, std::string& out) {
+    caesar_encrypt(s, -shift, out);
+}
+
+std::string caesar_encrypt(const std::string& s, int shift) {
+    std::string out;
+    caesar_encrypt(s, shift, out);
     return out;
 }
 
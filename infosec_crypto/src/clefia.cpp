@@ -1,9 +1,14 @@
 // src/clefia.cpp
 
 #include "crypto/clefia.hpp"
-#include <fstream>
-#include <stdexcept>
+#include "crypto/metrics.hpp"
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace crypto {
 
@@ -145,7 +150,7 @@ void Clefia128::sigma_doubleswap(std::array<uint8_t,16>& L) {
 
 
 // CON(128) constants table from spec, 60 words [web:6][web:27]
-static const uint32_t CON128[60] = {
+const uint32_t Clefia128::CON128[60] = {
     0xf56b7aeb,0x994a8a42,0x96a4bd75,0xfa854521,
     0x735b768a,0x1f7abac4,0xd5bc3b45,0xb99d5d62,
     0x52d73592,0x3ef636e5,0xc57a1ac9,0xa95b9b72,
@@ -207,17 +212,24 @@ void Clefia128::expand_key_128(const Key& key, std::array<uint32_t,4>& WK,
 }
 
 void Clefia128::setKey(const Key& k) {
+    CRYPTO_COUNT(KeySchedules, 1);
     expand_key_128(k, WK, RK);
 }
 
 void Clefia128::encryptBlock(const Block& in, Block& out) const {
+    encryptBlockRounds(in, out, 18);
+}
+
+void Clefia128::encryptBlockRounds(const Block& in, Block& out, int rounds) const {
+    if (rounds < 1 || rounds > 18) throw std::invalid_argument("rounds");
+    CRYPTO_COUNT(BlocksEncrypted, 1);
     uint32_t P0=load_be32(&in[0]), P1=load_be32(&in[4]), P2=load_be32(&in[8]), P3=load_be32(&in[12]);
     // initial whitening [web:27]
     uint32_t T0=P0;
     uint32_t T1=P1 ^ WK[0];
     uint32_t T2=P2;
     uint32_t T3=P3 ^ WK[1];
-    GFN4r_encrypt(RK, 18, T0,T1,T2,T3);
+    GFN4r_encrypt(RK, rounds, T0,T1,T2,T3);
     uint32_t C0=T0;
     uint32_t C1=T1 ^ WK[2];
     uint32_t C2=T2;
@@ -227,6 +239,7 @@ void Clefia128::encryptBlock(const Block& in, Block& out) const {
 }
 
 void Clefia128::decryptBlock(const Block& in, Block& out) const {
+    CRYPTO_COUNT(BlocksDecrypted, 1);
     uint32_t C0=load_be32(&in[0]), C1=load_be32(&in[4]), C2=load_be32(&in[8]), C3=load_be32(&in[12]);
     uint32_t T0=C0;
     uint32_t T1=C1 ^ WK[2];
@@ -244,62 +257,155 @@ void Clefia128::decryptBlock(const Block& in, Block& out) const {
 // CBC mode with PKCS#7 [web:27]
 static void xor_block(uint8_t* a, const uint8_t* b) { for (int i=0;i<16;i++) a[i]^=b[i]; }
 
+// Unbuffered file I/O for the streaming CBC functions: no stream buffers are
+// allocated, all data goes through the Workspace
+namespace {
+struct FileFd {
+    int fd;
+    explicit FileFd(int f) : fd(f) {}
+    ~FileFd() { if (fd >= 0) ::close(fd); }
+    FileFd(const FileFd&) = delete;
+    FileFd& operator=(const FileFd&) = delete;
+};
+} // namespace
+
+// Reads until n bytes or EOF, returns the count
+static size_t read_full(int fd, uint8_t* buf, size_t n) {
+    size_t got = 0;
+    while (got < n) {
+        ssize_t r = ::read(fd, buf + got, n - got);
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0) throw std::runtime_error("read");
+        if (r == 0) break;
+        got += (size_t)r;
+    }
+    CRYPTO_COUNT(IoBytesRead, got);
+    return got;
+}
+
+static void write_all(int fd, const uint8_t* buf, size_t n) {
+    CRYPTO_COUNT(IoBytesWritten, n);
+    while (n > 0) {
+        ssize_t r = ::write(fd, buf, n);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) throw std::runtime_error("write");
+        buf += r; n -= (size_t)r;
+    }
+}
+
+static int open_output(const std::string& path) {
+    return ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+}
+
+// Chunk for the one-shot overloads: the file size plus one block (room for the
+// padding block / EOF check), capped at the default, so small files do not pay
+// for a 64 KiB buffer. An unreadable path gets the minimum; open() then throws
+static size_t oneshot_chunk(const std::string& path) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) return 16;
+    if (!S_ISREG(st.st_mode)) return Workspace::kDefaultChunk;
+    uint64_t need = (uint64_t)st.st_size / 16 * 16 + 16;
+    return (size_t)std::min<uint64_t>(need, Workspace::kDefaultChunk);
+}
+
 void Clefia128::cbc_encrypt_file(const std::string& in_path, const std::string& out_path,
                                  const Key& key, const Block& iv) {
+    Workspace ws(oneshot_chunk(in_path));
+    cbc_encrypt_file(in_path, out_path, key, iv, ws);
+}
+
+void Clefia128::cbc_decrypt_file(const std::string& in_path, const std::string& out_path,
+                                 const Key& key, const Block& iv) {
+    Workspace ws(oneshot_chunk(in_path));
+    cbc_decrypt_file(in_path, out_path, key, iv, ws);
+}
+
+void Clefia128::cbc_encrypt_file(const std::string& in_path, const std::string& out_path,
+                                 const Key& key, const Block& iv, Workspace& ws) {
+    CRYPTO_TIME(CbcEncryptFile);
     Clefia128 cipher(key);
-    std::ifstream in(in_path, std::ios::binary);
-    if (!in) throw std::runtime_error("open input");
-    std::ofstream out(out_path, std::ios::binary);
-    if (!out) throw std::runtime_error("open output");
-
-    Block prev = iv;
-    std::vector<uint8_t> buf((std::istreambuf_iterator<char>(in)), {});
-    size_t n = buf.size();
-    size_t full = n / 16;
-    size_t rem  = n % 16;
-
-    size_t offset=0;
-    for (size_t i=0;i<full;i++,offset+=16){
-        Block blk{}; std::memcpy(blk.data(), buf.data()+offset, 16);
-        xor_block(blk.data(), prev.data());
-        Block ct{}; cipher.encryptBlock(blk, ct);
-        out.write((char*)ct.data(), 16);
-        prev = ct;
+    FileFd in(::open(in_path.c_str(), O_RDONLY));
+    if (in.fd < 0) throw std::runtime_error("open input");
+    FileFd out(open_output(out_path));
+    if (out.fd < 0) throw std::runtime_error("open output");
+
+    uint8_t* buf = ws.io();
+    const size_t chunk = ws.chunk();
+    Block prev = iv, blk{};
+    for (;;) {
+        size_t n = read_full(in.fd, buf, chunk);
+        bool last = n < chunk;
+        size_t full = n / 16 * 16;
+        if (last) {
+            // pad last; chunk is a multiple of 16, so the padded block still fits
+            uint8_t pad = (uint8_t)(16 - (n - full));
+            for (size_t i=n;i<full+16;i++) buf[i]=pad;
+            full += 16;
+        }
+        for (size_t off=0; off<full; off+=16) {
+            std::memcpy(blk.data(), buf+off, 16);
+            xor_block(blk.data(), prev.data());
+            cipher.encryptBlock(blk, prev);
+            std::memcpy(buf+off, prev.data(), 16);
+        }
+        write_all(out.fd, buf, full);
+        if (last) break;
     }
-    // pad last
-    Block last{};
-    if (rem) std::memcpy(last.data(), buf.data()+offset, rem);
-    uint8_t pad = 16 - (uint8_t)rem;
-    for (int i=rem;i<16;i++) last[i]=pad;
-    xor_block(last.data(), prev.data());
-    Block ct{}; cipher.encryptBlock(last, ct);
-    out.write((char*)ct.data(), 16);
 }
 
 void Clefia128::cbc_decrypt_file(const std::string& in_path, const std::string& out_path,
-                                 const Key& key, const Block& iv) {
+                                 const Key& key, const Block& iv, Workspace& ws) {
+    CRYPTO_TIME(CbcDecryptFile);
     Clefia128 cipher(key);
-    std::ifstream in(in_path, std::ios::binary);
-    if (!in) throw std::runtime_error("open input");
-    std::vector<uint8_t> all((std::istreambuf_iterator<char>(in)), {});
-    if (all.size() % 16) throw std::runtime_error("bad length");
-    std::ofstream out(out_path, std::ios::binary);
-    if (!out) throw std::runtime_error("open output");
-    Block prev = iv;
-    for (size_t off=0; off<all.size(); off+=16) {
-        Block ct{}; std::memcpy(ct.data(), all.data()+off, 16);
-        Block pt{}; cipher.decryptBlock(ct, pt);
-        xor_block(pt.data(), prev.data());
-        prev = ct;
-        // handle last block padding
-        if (off + 16 == all.size()) {
-            uint8_t pad = pt[15];
-            if (pad==0 || pad>16) throw std::runtime_error("bad pad");
-            size_t out_len = 16 - pad;
-            out.write((char*)pt.data(), out_len);
-        } else {
-            out.write((char*)pt.data(), 16);
+    FileFd in(::open(in_path.c_str(), O_RDONLY));
+    if (in.fd < 0) throw std::runtime_error("open input");
+    struct stat st;
+    if (::fstat(in.fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size % 16)
+        throw std::runtime_error("bad length");
+    FileFd out(open_output(out_path));
+    if (out.fd < 0) throw std::runtime_error("open output");
+
+    // The last plaintext block is held back until EOF shows it carries the padding
+    uint8_t* buf = ws.io();
+    const size_t chunk = ws.chunk();
+    Block prev = iv, held{}, ct{}, pt{};
+    bool have_held = false;
+    for (;;) {
+        size_t n = read_full(in.fd, buf, chunk);
+        if (n % 16) throw std::runtime_error("bad length");
+        if (n == 0) break;
+        if (have_held) write_all(out.fd, held.data(), 16);
+        for (size_t off=0; off<n; off+=16) {
+            std::memcpy(ct.data(), buf+off, 16);
+            cipher.decryptBlock(ct, pt);
+            xor_block(pt.data(), prev.data());
+            prev = ct;
+            std::memcpy(buf+off, pt.data(), 16);
+        }
+        std::memcpy(held.data(), buf+n-16, 16);
+        have_held = true;
+        write_all(out.fd, buf, n-16);
+        if (n < chunk) break;
+    }
+    if (have_held) {
+        uint8_t pad = held[15];
+        if (pad==0 || pad>16) throw std::runtime_error("bad pad");
+        write_all(out.fd, held.data(), 16 - pad);
+    }
+}
+
+// CTR mode
+Clefia128Ctr::Clefia128Ctr(const Clefia128::Key& key, const Clefia128::Block& iv)
+    : cipher(key), ctr(iv) {}
+
+void Clefia128Ctr::apply(uint8_t* buf, size_t n) {
+    for (size_t i=0;i<n;i++){
+        if (used == 16) {
+            cipher.encryptBlock(ctr, ks);
+            for (int j=15;j>=0;j--) if (++ctr[j] != 0) break;
+            used = 0;
         }
+        buf[i] ^= ks[used++];
     }
 }
 
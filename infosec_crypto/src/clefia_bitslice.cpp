@@ -0,0 +1,346 @@
+// src/clefia_bitslice.cpp
+
+#include "crypto/clefia_bitslice.hpp"
+#include "crypto/bitmatrix.hpp"
+#include "crypto/metrics.hpp"
+#include <algorithm>
+
+namespace crypto {
+
+// One slice = 4 x 64 lanes (GCC vector extension): AVX2 with -mavx2, SSE2 pairs otherwise.
+// Group g of a slice (element [g]) carries blocks 64g..64g+63, block 64g+r at bit 63-r.
+typedef uint64_t Slice __attribute__((vector_size(32)));
+constexpr size_t kGroups = sizeof(Slice) / sizeof(uint64_t);
+static_assert(kGroups * 64 == Clefia128Bitsliced::kLanes, "lane count");
+
+// Byte in slices: x[t] holds bit t (t = 0 is the LSB) of the byte in every lane.
+// 32-bit word: w[q] holds bit q, so big-endian byte k of the word is w + 8*(3-k).
+
+// 4-bit S-boxes SS0..SS3 that S0 is built from (RFC 6114, 3.2.4)
+using Table16 = std::array<uint8_t,16>;
+static constexpr Table16 SS0 = {0xe,0x6,0xc,0xa,0x8,0x7,0x2,0xf,0xb,0x1,0x4,0x0,0x5,0x9,0xd,0x3};
+static constexpr Table16 SS1 = {0x6,0x4,0x0,0xd,0x2,0xb,0xa,0x3,0x9,0xc,0xe,0xf,0x8,0x7,0x5,0x1};
+static constexpr Table16 SS2 = {0xb,0x8,0x5,0xe,0xa,0x6,0x4,0xc,0xf,0x7,0x2,0x3,0x1,0x0,0xd,0x9};
+static constexpr Table16 SS3 = {0xa,0x2,0x6,0xd,0x3,0x4,0x5,0xe,0x0,0x7,0x8,0x9,0xb,0xf,0xc,0x1};
+
+// GF(2^4) with polynomial x^4+x+1: used by S0 and by the tower-field inversion in S1
+static constexpr uint8_t gf16_mul_const(uint8_t a, uint8_t b) {
+    uint8_t r = 0;
+    for (int i=0;i<4;i++) if ((b >> i) & 1) r ^= (uint8_t)(a << i);
+    for (int k=6;k>=4;k--) if ((r >> k) & 1) r ^= (uint8_t)(0x13 << (k-4));
+    return r;
+}
+
+static constexpr Table16 gf16_inv_table() {
+    Table16 t{};
+    for (int a=1;a<16;a++)
+        for (int b=1;b<16;b++) if (gf16_mul_const((uint8_t)a, (uint8_t)b) == 1) t[a] = (uint8_t)b;
+    return t;
+}
+
+// Algebraic normal form of a 4-bit S-box: bit u of out[o] is the coefficient of
+// the monomial prod_{j in u} x_j in output bit o (Moebius transform of the truth table)
+struct Anf4 { uint16_t out[4]; };
+
+static constexpr Anf4 anf4(const Table16& t) {
+    Anf4 r{};
+    for (int o=0;o<4;o++){
+        uint16_t f = 0;
+        for (int x=0;x<16;x++) f |= (uint16_t)(((t[x] >> o) & 1) << x);
+        for (int j=0;j<4;j++)
+            for (int u=0;u<16;u++)
+                if (u & (1 << j)) f ^= (uint16_t)(((f >> (u ^ (1 << j))) & 1) << u);
+        r.out[o] = f;
+    }
+    return r;
+}
+
+static constexpr Anf4 kSS0 = anf4(SS0);
+static constexpr Anf4 kSS1 = anf4(SS1);
+static constexpr Anf4 kSS2 = anf4(SS2);
+static constexpr Anf4 kSS3 = anf4(SS3);
+static constexpr Anf4 kInv16 = anf4(gf16_inv_table());
+
+// Evaluates the ANF as AND/XOR; coefficients are compile-time constants, so
+// after unrolling only the monomials actually present remain
+template <const Anf4& A>
+static inline void sbox4(const Slice x[4], Slice y[4]) {
+    Slice m[16];
+    m[0] = ~Slice{};
+#pragma GCC unroll 16
+    for (int u=1;u<16;u++) {
+        int j = (u & 8) ? 3 : (u & 4) ? 2 : (u & 2) ? 1 : 0; // highest variable of u
+        m[u] = m[u ^ (1 << j)] & x[j];
+    }
+#pragma GCC unroll 4
+    for (int o=0;o<4;o++) {
+        Slice acc{};
+#pragma GCC unroll 16
+        for (int u=0;u<16;u++) if ((A.out[o] >> u) & 1) acc ^= m[u];
+        y[o] = acc;
+    }
+}
+
+// y = L*x over GF(2), Cols[j] is the image of unit vector j
+template <size_t N, const std::array<uint8_t,N>& Cols>
+static inline void linear(const Slice* x, Slice* y) {
+#pragma GCC unroll 8
+    for (size_t i=0;i<N;i++) {
+        Slice acc{};
+#pragma GCC unroll 8
+        for (size_t j=0;j<N;j++) if ((Cols[j] >> i) & 1) acc ^= x[j];
+        y[i] = acc;
+    }
+}
+
+// Multiplication by 2 in GF(2^4)
+static inline void gf16_mul2(const Slice x[4], Slice y[4]) {
+    y[0] = x[3]; y[1] = x[0] ^ x[3]; y[2] = x[1]; y[3] = x[2];
+}
+
+static inline void gf16_mul(const Slice a[4], const Slice b[4], Slice r[4]) {
+    Slice p[7] = {};
+#pragma GCC unroll 4
+    for (int i=0;i<4;i++)
+#pragma GCC unroll 4
+        for (int j=0;j<4;j++) p[i+j] ^= a[i] & b[j];
+#pragma GCC unroll 3
+    for (int k=6;k>=4;k--) { p[k-4] ^= p[k]; p[k-3] ^= p[k]; }
+#pragma GCC unroll 4
+    for (int t=0;t<4;t++) r[t] = p[t];
+}
+
+// S0: T0=SS0(hi), T1=SS1(lo); U0=T0^2*T1, U1=2*T0^T1; y = SS2(U0)<<4 | SS3(U1)
+static void s0(const Slice x[8], Slice y[8]) {
+    Slice t0[4], t1[4], m[4], u0[4], u1[4];
+    sbox4<kSS0>(x + 4, t0);
+    sbox4<kSS1>(x, t1);
+    gf16_mul2(t1, m);
+#pragma GCC unroll 4
+    for (int j=0;j<4;j++) u0[j] = t0[j] ^ m[j];
+    gf16_mul2(t0, m);
+#pragma GCC unroll 4
+    for (int j=0;j<4;j++) u1[j] = m[j] ^ t1[j];
+    sbox4<kSS2>(u0, y + 4);
+    sbox4<kSS3>(u1, y);
+}
+
+// Inversion in GF((2^4)^2) = GF(2^4)[y]/(y^2+y+9), a = a1*y + a0 (high / low nibble):
+//   a^-1 = (a1*D)*y + (a0^a1)*D,  D = (9*a1^2 ^ a1*a0 ^ a0^2)^-1,  0 -> 0
+static constexpr uint8_t kNu = 9;
+static constexpr std::array<uint8_t,4> kSq16 = {
+    gf16_mul_const(1,1), gf16_mul_const(2,2), gf16_mul_const(4,4), gf16_mul_const(8,8)};
+static constexpr std::array<uint8_t,4> kNuSq16 = {
+    gf16_mul_const(kNu,kSq16[0]), gf16_mul_const(kNu,kSq16[1]),
+    gf16_mul_const(kNu,kSq16[2]), gf16_mul_const(kNu,kSq16[3])};
+
+static void tower_inv(const Slice x[8], Slice r[8]) {
+    const Slice* a0 = x;
+    const Slice* a1 = x + 4;
+    Slice t[4], u[4], s[4], d[4], D[4];
+    gf16_mul(a1, a0, t);
+    linear<4, kNuSq16>(a1, u);
+    linear<4, kSq16>(a0, s);
+#pragma GCC unroll 4
+    for (int j=0;j<4;j++) d[j] = t[j] ^ u[j] ^ s[j];
+    sbox4<kInv16>(d, D);
+    gf16_mul(a1, D, r + 4);
+#pragma GCC unroll 4
+    for (int j=0;j<4;j++) s[j] = a0[j] ^ a1[j];
+    gf16_mul(s, D, r);
+}
+
+// S1 is inversion in GF(2^8)/0x11D between two affine maps. Moving the inversion
+// to the tower field above: S1(x) = B*inv'(A*(x ^ 0x5a)) ^ 0x69, where A and B
+// include the change of basis. Columns are images of unit vectors; the engine
+// is checked against the table-driven cipher in tests
+static constexpr std::array<uint8_t,8> kS1A = {0x01,0xe0,0xf1,0x30,0xe9,0x54,0xb2,0x69};
+static constexpr std::array<uint8_t,8> kS1B = {0xe3,0xb1,0x10,0x4e,0xb4,0xd3,0x9b,0x02};
+
+static void s1(const Slice x[8], Slice y[8]) {
+    Slice a[8], z[8], w[8];
+#pragma GCC unroll 8
+    for (int t=0;t<8;t++) a[t] = ((0x5a >> t) & 1) ? ~x[t] : x[t];
+    linear<8, kS1A>(a, z);
+    tower_inv(z, w);
+    linear<8, kS1B>(w, y);
+#pragma GCC unroll 8
+    for (int t=0;t<8;t++) if ((0x69 >> t) & 1) y[t] = ~y[t];
+}
+
+static inline void xtime(const Slice x[8], Slice y[8]) {
+    y[0] = x[7];
+#pragma GCC unroll 8
+    for (int t=1;t<8;t++) y[t] = x[t-1];
+    y[2] ^= x[7]; y[3] ^= x[7]; y[4] ^= x[7];
+}
+
+// y ^= F(rk, x). M0 and M1 are Hadamard matrices, M[i][k] = m[i^k], so
+//   M0 (1,2,4,6):  out_i = s_i ^ 2*((s_i1 ^ s_i3) ^ 2*(s_i2 ^ s_i3))
+//   M1 (1,8,2,10): out_i = s_i ^ 2*((s_i2 ^ s_i3) ^ 4*(s_i1 ^ s_i3))
+// with s_ik = s_{i^k}
+template <bool IsF0>
+static void F(const uint64_t rk[32], const Slice x[32], Slice y[32]) {
+    Slice v[32], s[4][8];
+#pragma GCC unroll 32
+    for (int q=0;q<32;q++) v[q] = x[q] ^ rk[q];
+#pragma GCC unroll 4
+    for (int k=0;k<4;k++) {
+        if (((k & 1) == 0) == IsF0) s0(v + 8*(3-k), s[k]);
+        else                        s1(v + 8*(3-k), s[k]);
+    }
+#pragma GCC unroll 4
+    for (int i=0;i<4;i++) {
+        Slice a[8], b[8], t[8];
+#pragma GCC unroll 8
+        for (int j=0;j<8;j++) {
+            a[j] = s[i^1][j] ^ s[i^3][j];
+            b[j] = s[i^2][j] ^ s[i^3][j];
+        }
+        if (IsF0) {
+            xtime(b, t);
+#pragma GCC unroll 8
+            for (int j=0;j<8;j++) a[j] ^= t[j];
+            xtime(a, t);
+        } else {
+            xtime(a, t); xtime(t, a);
+#pragma GCC unroll 8
+            for (int j=0;j<8;j++) b[j] ^= a[j];
+            xtime(b, t);
+        }
+        Slice* out = y + 8*(3-i);
+#pragma GCC unroll 8
+        for (int j=0;j<8;j++) out[j] ^= s[i][j] ^ t[j];
+    }
+}
+
+static inline void xor_word(Slice* w, const std::array<uint64_t,32>& k) {
+#pragma GCC unroll 32
+    for (int q=0;q<32;q++) w[q] ^= k[q];
+}
+
+static inline uint64_t load_be64(const uint8_t* p) {
+    return (uint64_t)p[0]<<56 | (uint64_t)p[1]<<48 | (uint64_t)p[2]<<40 | (uint64_t)p[3]<<32 |
+           (uint64_t)p[4]<<24 | (uint64_t)p[5]<<16 | (uint64_t)p[6]<<8  | (uint64_t)p[7];
+}
+static inline void store_be64(uint64_t v, uint8_t* p) {
+    p[0]=(uint8_t)(v>>56); p[1]=(uint8_t)(v>>48); p[2]=(uint8_t)(v>>40); p[3]=(uint8_t)(v>>32);
+    p[4]=(uint8_t)(v>>24); p[5]=(uint8_t)(v>>16); p[6]=(uint8_t)(v>>8);  p[7]=(uint8_t)v;
+}
+
+// GFN4,12 over CON128[0..23] runs on the bitsliced F with the key broadcast to
+// every lane, so the key schedule does no table lookups either; the Sigma /
+// XOR expansion that follows is shifts and XORs on the result
+void Clefia128Bitsliced::setKey(const Clefia128::Key& k) {
+    CRYPTO_COUNT(KeySchedules, 1);
+    auto spread = [](uint32_t w, std::array<uint64_t,32>& out) {
+        for (int q=0;q<32;q++) out[q] = 0 - (uint64_t)((w >> q) & 1);
+    };
+    uint32_t K[4];
+    Slice s[4][32];
+    for (int i=0;i<4;i++) {
+        K[i] = Clefia128::load_be32(&k[4*i]);
+        spread(K[i], WK[i]);
+        for (int q=0;q<32;q++) s[i][q] = Slice{} ^ WK[i][q];
+    }
+
+    Slice* T[4] = {s[0], s[1], s[2], s[3]};
+    std::array<uint64_t,32> c0, c1;
+    for (int i=0;i<12;i++) {
+        spread(Clefia128::CON128[2*i],   c0);
+        spread(Clefia128::CON128[2*i+1], c1);
+        F<true>(c0.data(),  T[0], T[1]);
+        F<false>(c1.data(), T[2], T[3]);
+        Slice* t0 = T[0]; T[0]=T[1]; T[1]=T[2]; T[2]=T[3]; T[3]=t0;
+    }
+
+    // L = (T3, T0, T1, T2); all lanes agree, take bit 0 of group 0
+    const Slice* Lw[4] = {T[3], T[0], T[1], T[2]};
+    std::array<uint8_t,16> L;
+    for (int i=0;i<4;i++) {
+        uint32_t w = 0;
+        for (int q=0;q<32;q++) w |= (uint32_t)(Lw[i][q][0] & 1) << q;
+        Clefia128::store_be32(w, &L[4*i]);
+    }
+    for (int i=0;i<=8;i++) {
+        for (int j=0;j<4;j++) {
+            uint32_t t = Clefia128::load_be32(&L[4*j]) ^ Clefia128::CON128[24 + 4*i + j];
+            if (i & 1) t ^= K[j]; // odd: XOR with K
+            spread(t, RK[4*i + j]);
+        }
+        Clefia128::sigma_doubleswap(L);
+    }
+}
+
+void Clefia128Bitsliced::encryptBlocks(const uint8_t* in, uint8_t* out, size_t n) const {
+    CRYPTO_COUNT(BlocksEncrypted, n);
+    process(in, out, n, false);
+}
+
+void Clefia128Bitsliced::decryptBlocks(const uint8_t* in, uint8_t* out, size_t n) const {
+    CRYPTO_COUNT(BlocksDecrypted, n);
+    process(in, out, n, true);
+}
+
+void Clefia128Bitsliced::process(const uint8_t* in, uint8_t* out, size_t n, bool decrypt) const {
+    uint64_t hi[64], lo[64];
+    Slice s[4][32];
+    for (size_t base = 0; base < n; base += kLanes) {
+        size_t lanes = std::min(kLanes, n - base);
+        for (size_t g=0; g<kGroups; g++) {
+            size_t live = lanes > 64*g ? std::min<size_t>(64, lanes - 64*g) : 0;
+            const uint8_t* src = live ? in + 16*(base + 64*g) : in;
+            for (size_t r=0;r<64;r++) {
+                hi[r] = r < live ? load_be64(src + 16*r)     : 0;
+                lo[r] = r < live ? load_be64(src + 16*r + 8) : 0;
+            }
+            transpose64(hi);
+            transpose64(lo);
+            // hi[c] is big-endian bit c of bytes 0..7: word c/32, bit 31 - c%32
+            for (int c=0;c<64;c++) {
+                s[c/32][31 - c%32][g]     = hi[c];
+                s[2 + c/32][31 - c%32][g] = lo[c];
+            }
+        }
+
+        // GFN4,18 on word pointers: the word rotation costs nothing
+        Slice* T[4] = {s[0], s[1], s[2], s[3]};
+        Slice* X[4];
+        if (!decrypt) {
+            xor_word(T[1], WK[0]); xor_word(T[3], WK[1]);
+            for (int i=0;i<18;i++) {
+                F<true>(RK[2*i].data(),    T[0], T[1]);
+                F<false>(RK[2*i+1].data(), T[2], T[3]);
+                Slice* t0 = T[0]; T[0]=T[1]; T[1]=T[2]; T[2]=T[3]; T[3]=t0;
+            }
+            X[0]=T[3]; X[1]=T[0]; X[2]=T[1]; X[3]=T[2];
+            xor_word(X[1], WK[2]); xor_word(X[3], WK[3]);
+        } else {
+            xor_word(T[1], WK[2]); xor_word(T[3], WK[3]);
+            for (int i=0;i<18;i++) {
+                F<true>(RK[2*(18-i)-2].data(),  T[0], T[1]);
+                F<false>(RK[2*(18-i)-1].data(), T[2], T[3]);
+                Slice* t3 = T[3]; T[3]=T[2]; T[2]=T[1]; T[1]=T[0]; T[0]=t3;
+            }
+            X[0]=T[1]; X[1]=T[2]; X[2]=T[3]; X[3]=T[0];
+            xor_word(X[1], WK[0]); xor_word(X[3], WK[1]);
+        }
+
+        for (size_t g=0; g<kGroups && 64*g < lanes; g++) {
+            size_t live = std::min<size_t>(64, lanes - 64*g);
+            for (int c=0;c<64;c++) {
+                hi[c] = X[c/32][31 - c%32][g];
+                lo[c] = X[2 + c/32][31 - c%32][g];
+            }
+            transpose64(hi);
+            transpose64(lo);
+            uint8_t* dst = out + 16*(base + 64*g);
+            for (size_t r=0;r<live;r++) {
+                store_be64(hi[r], dst + 16*r);
+                store_be64(lo[r], dst + 16*r + 8);
+            }
+        }
+    }
+}
+
+} // namespace crypto
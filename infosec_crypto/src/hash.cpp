@@ -1,35 +1,66 @@
 // src/hash.cpp
 
 #include "crypto/hash.hpp"
-#include <sstream>
-#include <iomanip>
+#include "crypto/metrics.hpp"
+#include <algorithm>
 #include <cstring>
 
 namespace crypto {
 
-std::array<uint8_t,16> clefia128_dm_hash(const std::vector<uint8_t>& in_msg) {
-    std::vector<uint8_t> msg = in_msg;
+void Clefia128DmHasher::compress(const uint8_t* block) {
+    crypto::Clefia128::Key K{};
+    std::memcpy(K.data(), block, 16);
+    crypto::Clefia128 cipher(K);
+    crypto::Clefia128::Block Hi = H, out{};
+    cipher.encryptBlock(Hi, out);
+    for (int i=0;i<16;i++) H[i] = out[i] ^ Hi[i];
+}
+
+void Clefia128DmHasher::update(const uint8_t* data, size_t n) {
+    CRYPTO_COUNT(BytesHashed, n);
+    if (n == 0) return; // data may be null for an empty update
+    if (used) {
+        size_t take = std::min(n, 16 - used);
+        std::memcpy(buf.data()+used, data, take);
+        used += take; data += take; n -= take;
+        if (used < 16) return;
+        compress(buf.data());
+        used = 0;
+    }
+    for (; n >= 16; data += 16, n -= 16) compress(data);
+    std::memcpy(buf.data(), data, n);
+    used = n;
+}
+
+std::array<uint8_t,16> Clefia128DmHasher::final() {
     // simple pad: 0x80 then zeros to multiple of 16
-    size_t rem = msg.size() % 16;
-    msg.push_back(0x80);
-    while ((msg.size() % 16) != 0) msg.push_back(0x00);
-
-    std::array<uint8_t,16> H{}; // H0 = 0^128
-    for (size_t off=0; off<msg.size(); off+=16) {
-        crypto::Clefia128::Key K{};
-        std::memcpy(K.data(), msg.data()+off, 16);
-        crypto::Clefia128 cipher(K);
-        crypto::Clefia128::Block Hi = H, out{};
-        cipher.encryptBlock(Hi, out);
-        for (int i=0;i<16;i++) H[i] = out[i] ^ Hi[i];
+    buf[used] = 0x80;
+    std::memset(buf.data()+used+1, 0, 15-used);
+    compress(buf.data());
+    std::array<uint8_t,16> digest = H;
+    H = {}; used = 0;
+    return digest;
+}
+
+std::array<uint8_t,16> clefia128_dm_hash(const std::vector<uint8_t>& in_msg) {
+    CRYPTO_TIME(Hash);
+    Clefia128DmHasher h;
+    h.update(in_msg.data(), in_msg.size());
+    return h.final();
+}
+
+void to_hex(const std::array<uint8_t,16>& d, char* out) {
+    static const char digits[] = "0123456789abcdef";
+    for (int i=0;i<16;i++){
+        out[2*i]   = digits[d[i] >> 4];
+        out[2*i+1] = digits[d[i] & 0xF];
     }
-    return H;
 }
 
 std::string to_hex(const std::array<uint8_t,16>& d) {
-    std::ostringstream oss; oss<<std::hex<<std::setfill('0');
-    for (auto b: d) oss<<std::setw(2)<<(int)b;
-    return oss.str();
+    std::string s(32, '\0');
+    to_hex(d, &s[0]);
+    return s;
 }
 
 double hamming_fraction(const std::array<uint8_t,16>& a,
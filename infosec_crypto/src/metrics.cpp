@@ -0,0 +1,151 @@
+// src/metrics.cpp
+
+#include "crypto/metrics.hpp"
+#include <atomic>
+#include <chrono>
+#include <sstream>
+
+namespace crypto {
+namespace metrics {
+
+static const char* const counter_names[kCounterCount] = {
+    "blocks_encrypted", "blocks_decrypted", "key_schedules",
+    "bytes_hashed", "io_bytes_read", "io_bytes_written"
+};
+static const char* const timer_names[kTimerCount] = {
+    "cbc_encrypt_file", "cbc_decrypt_file", "hash"
+};
+
+// One slot per live thread. Slots are pushed once onto a lock-free list and
+// never freed: when a thread exits, its slot is marked free and the next new
+// thread takes it over, so counts of finished threads stay in the totals and
+// the list is bounded by the peak number of concurrent threads
+struct Slot {
+    std::atomic<uint64_t> counters[kCounterCount];
+    std::atomic<uint64_t> buckets[kTimerCount][kBuckets];
+    std::atomic<uint64_t> count[kTimerCount];
+    std::atomic<uint64_t> sum_ns[kTimerCount];
+    std::atomic<bool> in_use{true};
+    Slot* next = nullptr;
+
+    Slot() {
+        for (auto& c : counters) c.store(0, std::memory_order_relaxed);
+        for (auto& row : buckets) for (auto& b : row) b.store(0, std::memory_order_relaxed);
+        for (auto& c : count) c.store(0, std::memory_order_relaxed);
+        for (auto& c : sum_ns) c.store(0, std::memory_order_relaxed);
+    }
+};
+
+static std::atomic<Slot*> slots{nullptr};
+
+static Slot* acquire_slot() {
+    for (Slot* s = slots.load(std::memory_order_acquire); s; s = s->next) {
+        bool free = false;
+        if (!s->in_use.load(std::memory_order_relaxed) &&
+            s->in_use.compare_exchange_strong(free, true, std::memory_order_acquire))
+            return s;
+    }
+    Slot* s = new Slot;
+    s->next = slots.load(std::memory_order_relaxed);
+    while (!slots.compare_exchange_weak(s->next, s, std::memory_order_release,
+                                        std::memory_order_relaxed)) {}
+    return s;
+}
+
+// Releases the slot at thread exit; the release store hands the last writes
+// over to the thread that acquires the slot next
+struct SlotOwner {
+    Slot* slot = acquire_slot();
+    ~SlotOwner() { slot->in_use.store(false, std::memory_order_release); }
+};
+
+static Slot& local_slot() {
+    thread_local SlotOwner owner;
+    return *owner.slot;
+}
+
+// Only the owning thread writes a slot: plain load+store instead of a locked RMW
+static inline void bump(std::atomic<uint64_t>& v, uint64_t n) {
+    v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+static uint64_t now_ns() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void add(Counter c, uint64_t n) {
+    bump(local_slot().counters[c], n);
+}
+
+void record(Timer t, uint64_t ns) {
+    Slot& s = local_slot();
+    int b = 0;
+    while (b < kBuckets - 1 && (ns >> b) != 0) b++;
+    bump(s.buckets[t][b], 1);
+    bump(s.count[t], 1);
+    bump(s.sum_ns[t], ns);
+}
+
+ScopedTimer::ScopedTimer(Timer t) : timer(t), start_ns(now_ns()) {}
+ScopedTimer::~ScopedTimer() { record(timer, now_ns() - start_ns); }
+
+Snapshot snapshot() {
+    Snapshot out;
+    for (Slot* s = slots.load(std::memory_order_acquire); s; s = s->next) {
+        for (int c=0;c<kCounterCount;c++) out.counters[c] += s->counters[c].load(std::memory_order_relaxed);
+        for (int t=0;t<kTimerCount;t++) {
+            for (int b=0;b<kBuckets;b++) out.buckets[t][b] += s->buckets[t][b].load(std::memory_order_relaxed);
+            out.count[t] += s->count[t].load(std::memory_order_relaxed);
+            out.sum_ns[t] += s->sum_ns[t].load(std::memory_order_relaxed);
+        }
+    }
+    return out;
+}
+
+std::string to_prometheus(const Snapshot& s) {
+    std::ostringstream o;
+    for (int c=0;c<kCounterCount;c++) {
+        o << "# TYPE crypto_" << counter_names[c] << "_total counter\n";
+        o << "crypto_" << counter_names[c] << "_total " << s.counters[c] << "\n";
+    }
+    o << "# TYPE crypto_op_duration_seconds histogram\n";
+    for (int t=0;t<kTimerCount;t++) {
+        uint64_t cum = 0;
+        for (int b=0;b<kBuckets-1;b++) {
+            cum += s.buckets[t][b];
+            o << "crypto_op_duration_seconds_bucket{op=\"" << timer_names[t] << "\",le=\""
+              << (double)(1ULL << b) * 1e-9 << "\"} " << cum << "\n";
+        }
+        o << "crypto_op_duration_seconds_bucket{op=\"" << timer_names[t] << "\",le=\"+Inf\"} " << s.count[t] << "\n";
+        o << "crypto_op_duration_seconds_sum{op=\"" << timer_names[t] << "\"} " << (double)s.sum_ns[t] * 1e-9 << "\n";
+        o << "crypto_op_duration_seconds_count{op=\"" << timer_names[t] << "\"} " << s.count[t] << "\n";
+    }
+    return o.str();
+}
+
+std::string to_json(const Snapshot& s) {
+    std::ostringstream o;
+    o << "{\"enabled\":" << (enabled ? "true" : "false") << ",\"counters\":{";
+    for (int c=0;c<kCounterCount;c++)
+        o << (c ? "," : "") << "\"" << counter_names[c] << "\":" << s.counters[c];
+    o << "},\"latency\":{";
+    for (int t=0;t<kTimerCount;t++) {
+        o << (t ? "," : "") << "\"" << timer_names[t] << "\":{\"count\":" << s.count[t]
+          << ",\"sum_ns\":" << s.sum_ns[t] << ",\"buckets\":[";
+        bool first = true;
+        for (int b=0;b<kBuckets;b++) {
+            if (!s.buckets[t][b]) continue;
+            o << (first ? "" : ",") << "{\"le_ns\":";
+            if (b == kBuckets - 1) o << "null"; else o << (1ULL << b);
+            o << ",\"count\":" << s.buckets[t][b] << "}";
+            first = false;
+        }
+        o << "]}";
+    }
+    o << "}}";
+    return o.str();
+}
+
+} // namespace metrics
+} // namespace crypto
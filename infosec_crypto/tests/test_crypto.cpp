@@ -1,18 +1,41 @@
 // tests/test_crypto.cpp
 #include "crypto/caesar.hpp"
 #include "crypto/clefia.hpp"
+#include "crypto/clefia_bitslice.hpp"
 #include "crypto/hash.hpp"
+#include "crypto/metrics.hpp"
+#include "crypto/workspace.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdlib>
 #include <cstring>
+#include <new>
 #include <iostream>
 #include <vector>
 #include <random>
 #include <fstream>
+#include <thread>
 #include <cstdio>    // std::remove
 
 using namespace crypto;
 
+// Счётчик аллокаций для проверки 9): все new/delete программы идут через malloc/free
+static std::atomic<size_t> g_allocs{0};
+
+void* operator new(std::size_t n) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t n) { return ::operator new(n); }
+// noinline: иначе GCC видит free() от указателя из new и ругается -Wmismatched-new-delete
+__attribute__((noinline)) void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { ::operator delete(p); }
+void operator delete(void* p, std::size_t) noexcept { ::operator delete(p); }
+void operator delete[](void* p, std::size_t) noexcept { ::operator delete(p); }
+
 static std::string bytes_to_hex(const std::vector<uint8_t>& v) {
     static const char* hex = "0123456789abcdef";
     std::string s; s.resize(v.size()*2);
@@ -67,6 +90,12 @@ int main() {
         cipher.decryptBlock(C, R);
         assert(std::memcmp(C.data(), Cexp.data(), 16) == 0 && "CLEFIA-128 encrypt matches RFC 6114");
         assert(std::memcmp(R.data(), P.data(), 16) == 0 && "CLEFIA-128 decrypt restores plaintext");
+
+        Clefia128::Block C18{}, C4{};
+        cipher.encryptBlockRounds(P, C18, 18);
+        cipher.encryptBlockRounds(P, C4, 4);
+        assert(C18 == Cexp && "18-round variant equals full cipher");
+        assert(C4 != Cexp);
         std::cout << "[OK] CLEFIA-128 block vector\n";
     }
 
@@ -159,6 +188,237 @@ int main() {
         std::cout << "[OK] DM-hash avalanche avg=" << avg << "\n";
     }
 
+    // 5) CLEFIA-128 CTR: потоковая обработка кусками == обработке целиком
+    {
+        std::mt19937 rng(777);
+        std::uniform_int_distribution<int> dist(0,255);
+        std::vector<uint8_t> data(1000);
+        for (auto& b : data) b = static_cast<uint8_t>(dist(rng));
+
+        Clefia128::Key key = {
+            0x00,0x11,0x22,0x33, 0x44,0x55,0x66,0x77,
+            0x88,0x99,0xaa,0xbb, 0xcc,0xdd,0xee,0xff
+        };
+        // IV у границы переполнения младших байт счётчика
+        Clefia128::Block iv = {
+            0x01,0x02,0x03,0x04, 0x05,0x06,0x07,0x08,
+            0x09,0x0a,0x0b,0x0c, 0x0d,0xff,0xff,0xfe
+        };
+
+        std::vector<uint8_t> whole = data;
+        Clefia128Ctr(key, iv).apply(whole.data(), whole.size());
+
+        std::vector<uint8_t> chunked = data;
+        Clefia128Ctr ctr(key, iv);
+        size_t off = 0, step = 1;
+        while (off < chunked.size()) {
+            size_t n = std::min(step, chunked.size() - off);
+            ctr.apply(chunked.data() + off, n);
+            off += n; step = step * 3 + 1;
+        }
+        assert(chunked == whole && "CTR chunked processing must match one-shot");
+        assert(whole != data);
+
+        Clefia128Ctr(key, iv).apply(whole.data(), whole.size());
+        assert(whole == data && "CTR applied twice restores plaintext");
+
+        // Первый блок гаммы = E_K(IV)
+        Clefia128::Block ks{}, zero{};
+        Clefia128(key).encryptBlock(iv, ks);
+        Clefia128Ctr(key, iv).apply(zero.data(), zero.size());
+        assert(zero == ks);
+
+        std::cout << "[OK] CLEFIA-128 CTR stream\n";
+    }
+
+    // 6) Инструментация: счётчики по потокам и дампы (с -DCRYPTO_INSTRUMENT)
+    {
+        auto before = metrics::snapshot();
+        Clefia128::Key key{};
+        Clefia128::Block b{}, c{};
+        auto work = [&] {
+            Clefia128 cipher(key);
+            for (int i=0;i<100;i++) cipher.encryptBlock(b, c);
+            cipher.decryptBlock(c, b);
+        };
+        std::thread t1(work), t2(work);
+        t1.join(); t2.join();
+        clefia128_dm_hash(std::vector<uint8_t>(40, 0x5a));
+        auto after = metrics::snapshot();
+
+        auto delta = [&](metrics::Counter k) { return after.counters[k] - before.counters[k]; };
+        if (metrics::enabled) {
+            assert(delta(metrics::BlocksEncrypted) == 2*100 + 3); // + 3 DM-блока (40 байт + паддинг)
+            assert(delta(metrics::BlocksDecrypted) == 2);
+            assert(delta(metrics::KeySchedules) == 2 + 3);
+            assert(delta(metrics::BytesHashed) == 40);
+            assert(after.count[metrics::Hash] == before.count[metrics::Hash] + 1);
+
+            // Слоты завершившихся потоков переиспользуются, их счётчики не теряются
+            for (int i = 0; i < 50; i++) std::thread(work).join();
+            auto reused = metrics::snapshot();
+            assert(reused.counters[metrics::BlocksEncrypted] - after.counters[metrics::BlocksEncrypted] == 50*100);
+        } else {
+            assert(delta(metrics::BlocksEncrypted) == 0 && after.count[metrics::Hash] == 0);
+        }
+        std::string prom = metrics::to_prometheus(after);
+        std::string json = metrics::to_json(after);
+        assert(prom.find("crypto_blocks_encrypted_total") != std::string::npos);
+        assert(prom.find("le=\"+Inf\"") != std::string::npos);
+        assert(json.front() == '{' && json.back() == '}');
+
+        std::cout << "[OK] metrics (" << (metrics::enabled ? "enabled" : "disabled") << ")\n";
+    }
+
+    // 7) DM-хеш: инкрементальный хешер == хешу целиком, to_hex
+    {
+        std::mt19937 rng(99);
+        std::uniform_int_distribution<int> dist(0,255);
+        for (size_t len : {0u, 1u, 15u, 16u, 17u, 100u, 1000u}) {
+            std::vector<uint8_t> m(len);
+            for (auto& b : m) b = static_cast<uint8_t>(dist(rng));
+            auto whole = clefia128_dm_hash(m);
+
+            Clefia128DmHasher h;
+            size_t off = 0, step = 1;
+            while (off < m.size()) {
+                size_t n = std::min(step, m.size() - off);
+                h.update(m.data() + off, n);
+                off += n; step = step * 2 + 1;
+            }
+            assert(h.final() == whole && "incremental DM hash must match one-shot");
+            assert(to_hex(whole) == bytes_to_hex(std::vector<uint8_t>(whole.begin(), whole.end())));
+        }
+        std::cout << "[OK] DM-hash incremental\n";
+    }
+
+    // 8) Bitsliced CLEFIA-128: совпадает с табличной реализацией
+    {
+        Clefia128::Key K = {
+            0xff,0xee,0xdd,0xcc, 0xbb,0xaa,0x99,0x88,
+            0x77,0x66,0x55,0x44, 0x33,0x22,0x11,0x00
+        };
+        Clefia128::Block P = {
+            0x00,0x01,0x02,0x03, 0x04,0x05,0x06,0x07,
+            0x08,0x09,0x0a,0x0b, 0x0c,0x0d,0x0e,0x0f
+        };
+        Clefia128::Block Cexp = {
+            0xde,0x2b,0xf2,0xfd, 0x9b,0x74,0xaa,0xcd,
+            0xf1,0x29,0x85,0x55, 0x45,0x94,0x94,0xfd
+        };
+        Clefia128 table(K);
+        Clefia128Bitsliced sliced(K);
+        Clefia128::Block C{};
+        sliced.encryptBlocks(P.data(), C.data(), 1);
+        assert(C == Cexp && "bitsliced encrypt matches RFC 6114");
+
+        std::mt19937 rng(2024);
+        std::uniform_int_distribution<int> dist(0,255);
+        const size_t L = Clefia128Bitsliced::kLanes;
+        for (size_t n : {size_t(2), size_t(63), size_t(64), size_t(65), L - 1, L, L + 1, 3*L + 7}) {
+            std::vector<uint8_t> pt(16*n), ct(16*n), expect(16*n);
+            for (auto& b : pt) b = static_cast<uint8_t>(dist(rng));
+            for (size_t i=0;i<n;i++) {
+                Clefia128::Block in{}, out{};
+                std::memcpy(in.data(), &pt[16*i], 16);
+                table.encryptBlock(in, out);
+                std::memcpy(&expect[16*i], out.data(), 16);
+            }
+            sliced.encryptBlocks(pt.data(), ct.data(), n);
+            assert(ct == expect && "bitsliced encrypt == table encrypt");
+
+            sliced.decryptBlocks(ct.data(), ct.data(), n); // in place
+            assert(ct == pt && "bitsliced decrypt restores plaintext");
+        }
+
+        // Собственное расписание ключей: случайные ключи против табличного
+        for (int t = 0; t < 32; t++) {
+            Clefia128::Key k{};
+            for (auto& b : k) b = static_cast<uint8_t>(dist(rng));
+            Clefia128 ref(k);
+            sliced.setKey(k);
+            Clefia128::Block in{}, out{}, expect{};
+            for (auto& b : in) b = static_cast<uint8_t>(dist(rng));
+            ref.encryptBlock(in, expect);
+            sliced.encryptBlocks(in.data(), out.data(), 1);
+            assert(out == expect && "bitsliced key schedule == table key schedule");
+        }
+        std::cout << "[OK] CLEFIA-128 bitsliced\n";
+    }
+
+    // 9) Workspace: потоковый CBC при любом размере куска, и ноль аллокаций в цикле
+    {
+        Clefia128::Key key = {
+            0x00,0x11,0x22,0x33, 0x44,0x55,0x66,0x77,
+            0x88,0x99,0xaa,0xbb, 0xcc,0xdd,0xee,0xff
+        };
+        Clefia128::Block iv = {
+            0x10,0x20,0x30,0x40, 0x50,0x60,0x70,0x80,
+            0x90,0xa0,0xb0,0xc0, 0xd0,0xe0,0xf0,0x00
+        };
+        const char* in_path = "test_ws_in.bin";
+        const char* enc_path = "test_ws_enc.bin";
+        const char* enc2_path = "test_ws_enc2.bin";
+        const char* dec_path = "test_ws_dec.bin";
+        auto read_file = [](const char* path) {
+            std::ifstream f(path, std::ios::binary);
+            return std::vector<uint8_t>(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+        };
+
+        // Куски по 16 и 48 байт дают тот же шифртекст, что и кусок по умолчанию
+        std::mt19937 rng(777);
+        std::uniform_int_distribution<int> dist(0,255);
+        Workspace small(16), odd(50), def;
+        assert(odd.chunk() == 48);
+        for (size_t n : {size_t(0), size_t(15), size_t(16), size_t(17), size_t(47), size_t(48), size_t(1000)}) {
+            std::vector<uint8_t> data(n);
+            for (auto& b : data) b = static_cast<uint8_t>(dist(rng));
+            {
+                std::ofstream f(in_path, std::ios::binary);
+                f.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(n));
+            }
+            Clefia128::cbc_encrypt_file(in_path, enc_path, key, iv, def);
+            auto ct = read_file(enc_path);
+            assert(ct.size() == (n/16 + 1) * 16);
+            for (Workspace* ws : {&small, &odd}) {
+                Clefia128::cbc_encrypt_file(in_path, enc2_path, key, iv, *ws);
+                assert(read_file(enc2_path) == ct && "CBC does not depend on chunk size");
+                Clefia128::cbc_decrypt_file(enc_path, dec_path, key, iv, *ws);
+                assert(read_file(dec_path) == data);
+            }
+        }
+
+        std::string text = "The quick brown fox jumps over the lazy dog", caesar_out;
+        std::vector<uint8_t> msg(300, 0x42);
+        Clefia128DmHasher hasher;
+        auto iteration = [&] {
+            Clefia128::cbc_encrypt_file(in_path, enc_path, key, iv, def);
+            Clefia128::cbc_decrypt_file(enc_path, dec_path, key, iv, def);
+            caesar_encrypt(text, 7, caesar_out);
+            caesar_decrypt(caesar_out, 7, caesar_out);
+            hasher.update(msg.data(), msg.size());
+            (void)hasher.final();
+            (void)clefia128_dm_hash(msg);
+        };
+        iteration(); // прогрев: слоты метрик потока и т.п.
+        size_t before = g_allocs.load();
+        for (int i=0;i<100;i++) iteration();
+        size_t allocs = g_allocs.load() - before;
+        assert(caesar_out == text);
+        assert(allocs == 0 && "hot paths with a Workspace do not allocate");
+
+        before = g_allocs.load();
+        for (int i=0;i<100;i++) {
+            Clefia128::cbc_encrypt_file(in_path, enc_path, key, iv);
+            Clefia128::cbc_decrypt_file(enc_path, dec_path, key, iv);
+            (void)caesar_encrypt(text, 7);
+        }
+        size_t legacy = g_allocs.load() - before;
+
+        std::remove(in_path); std::remove(enc_path); std::remove(enc2_path); std::remove(dec_path);
+        std::cout << "[OK] Workspace (0 allocs/iter, legacy API: " << legacy / 100 << ")\n";
+    }
+
     std::cout << "All tests passed.\n";
     return 0;
 }
@@ -0,0 +1,77 @@
+// tools/clefia_bench.cpp
+//
+// Crossover benchmark: table-driven Clefia128::encryptBlock in a loop vs
+// Clefia128Bitsliced::encryptBlocks, for batches of 1..N blocks per call.
+// The bitsliced engine always pays for a full pass of kLanes blocks, so it
+// only wins once batches are large enough; the tool prints where that happens.
+//
+// usage: clefia_bench [max_blocks] [ms_per_point]
+
+#include "crypto/clefia.hpp"
+#include "crypto/clefia_bitslice.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace crypto;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Runs fn() until at least ms milliseconds have passed, returns calls per second
+template <class Fn>
+static double rate(double ms, Fn fn) {
+    uint64_t calls = 0;
+    auto t0 = Clock::now();
+    double elapsed = 0;
+    do {
+        for (int i=0;i<8;i++) fn();
+        calls += 8;
+        elapsed = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+    } while (elapsed < ms);
+    return (double)calls * 1000.0 / elapsed;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t max_blocks = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 16384;
+    double ms = argc > 2 ? std::atof(argv[2]) : 200;
+    if (max_blocks == 0 || ms <= 0) {
+        std::fprintf(stderr, "usage: %s [max_blocks] [ms_per_point]\n", argv[0]);
+        return 2;
+    }
+
+    Clefia128::Key key = {
+        0x00,0x11,0x22,0x33, 0x44,0x55,0x66,0x77,
+        0x88,0x99,0xaa,0xbb, 0xcc,0xdd,0xee,0xff
+    };
+    Clefia128 table(key);
+    Clefia128Bitsliced sliced(key);
+    std::vector<uint8_t> buf(16 * max_blocks, 0x5a);
+
+    std::printf("lanes per pass: %zu\n", Clefia128Bitsliced::kLanes);
+    std::printf("%8s %14s %14s %8s\n", "blocks", "table MB/s", "bitslice MB/s", "ratio");
+    size_t crossover = 0;
+    for (size_t n = 1; n <= max_blocks; n *= 2) {
+        double t = rate(ms, [&] {
+            Clefia128::Block in{}, out{};
+            for (size_t i=0;i<n;i++) {
+                std::memcpy(in.data(), &buf[16*i], 16);
+                table.encryptBlock(in, out);
+                std::memcpy(&buf[16*i], out.data(), 16);
+            }
+        });
+        double b = rate(ms, [&] { sliced.encryptBlocks(buf.data(), buf.data(), n); });
+        double mb = 16.0 * (double)n / 1e6;
+        std::printf("%8zu %14.1f %14.1f %8.2f\n", n, t * mb, b * mb, b / t);
+        if (!crossover && b > t) crossover = n;
+    }
+    if (crossover) std::printf("crossover: bitsliced is faster from %zu blocks per call\n", crossover);
+    else           std::printf("crossover: none up to %zu blocks\n", max_blocks);
+    return 0;
+}
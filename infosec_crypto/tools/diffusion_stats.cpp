@@ -0,0 +1,238 @@
+// tools/diffusion_stats.cpp
+//
+// Statistical diffusion tests for CLEFIA-128 and the DM hash:
+// strict avalanche criterion (SAC) and bit independence criterion (BIC).
+//
+// One trial = random 128-bit input x plus 128 single-bit flips x ^ e_i.
+// Avalanche vectors d = f(x) ^ f(x ^ e_i) of 64 trials are transposed into
+// 128 column masks (one 64-bit word per output bit), so counters are updated
+// with popcounts: SAC[i][j] += popcnt(col[j]), BIC[i][j,k] += popcnt(col[j] & col[k]).
+// BIC is kept per input bit i: the 128 flips of one trial share x and f(x), so
+// only samples with the same i come from independent trials.
+// Every thread owns its counters; they are merged once at the end.
+//
+// usage: diffusion_stats cipher|hash|rounds=N [trials] [threads] [csv_prefix]
+
+#include "crypto/bitmatrix.hpp"
+#include "crypto/clefia.hpp"
+#include "crypto/hash.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace crypto;
+
+namespace {
+
+constexpr int kBits = 128;
+constexpr int kPairs = kBits * (kBits - 1) / 2; // output pairs j<k, in row order
+constexpr int kBatch = 64;
+
+struct Counters {
+    std::vector<uint64_t> sac = std::vector<uint64_t>(kBits * kBits);  // [input i][output j]
+    std::vector<uint64_t> bic = std::vector<uint64_t>(kBits * kPairs); // [input i][pair (j,k)]
+    uint64_t trials = 0;
+
+    void merge(const Counters& o) {
+        for (size_t i = 0; i < sac.size(); i++) sac[i] += o.sac[i];
+        for (size_t i = 0; i < bic.size(); i++) bic[i] += o.bic[i];
+        trials += o.trials;
+    }
+};
+
+// splitmix64: per-thread input generator
+struct Rng {
+    uint64_t s;
+    uint64_t next() {
+        uint64_t z = (s += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+};
+
+static uint64_t load_be64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i=0;i<8;i++) v = (v << 8) | p[i];
+    return v;
+}
+
+// Function under test: maps 16 input bytes to 16 output bytes
+struct Target {
+    enum Kind { Cipher, Hash } kind = Cipher;
+    int rounds = 18;
+    Clefia128 cipher;
+
+    void eval(const Clefia128::Block& in, Clefia128::Block& out) const {
+        if (kind == Hash) {
+            Clefia128DmHasher h; // on the stack: no allocation per evaluation
+            h.update(in.data(), in.size());
+            out = h.final();
+        } else {
+            cipher.encryptBlockRounds(in, out, rounds);
+        }
+    }
+};
+
+static void run_worker(const Target& target, uint64_t batches, uint64_t seed, Counters& c) {
+    Rng rng{seed};
+    Clefia128::Block x[kBatch], fx[kBatch], y{};
+    uint64_t hi[kBatch], lo[kBatch];
+
+    for (uint64_t b = 0; b < batches; b++) {
+        for (int s = 0; s < kBatch; s++) {
+            uint64_t r0 = rng.next(), r1 = rng.next();
+            for (int k = 0; k < 8; k++) { x[s][k] = (uint8_t)(r0 >> (56 - 8*k)); x[s][8+k] = (uint8_t)(r1 >> (56 - 8*k)); }
+            target.eval(x[s], fx[s]);
+        }
+        for (int i = 0; i < kBits; i++) {
+            for (int s = 0; s < kBatch; s++) {
+                Clefia128::Block xi = x[s];
+                xi[i / 8] ^= (uint8_t)(0x80u >> (i % 8));
+                target.eval(xi, y);
+                for (int k = 0; k < 16; k++) y[k] ^= fx[s][k];
+                hi[s] = load_be64(&y[0]);
+                lo[s] = load_be64(&y[8]);
+            }
+            // col[j]: bit s set <=> output bit j flipped in sample s
+            transpose64(hi);
+            transpose64(lo);
+            uint64_t col[kBits];
+            std::memcpy(col, hi, sizeof(hi));
+            std::memcpy(col + 64, lo, sizeof(lo));
+
+            uint64_t* sac_row = &c.sac[i * kBits];
+            uint64_t* bic_pair = &c.bic[(size_t)i * kPairs];
+            for (int j = 0; j < kBits; j++) {
+                sac_row[j] += (uint64_t)__builtin_popcountll(col[j]);
+                for (int k = j + 1; k < kBits; k++)
+                    *bic_pair++ += (uint64_t)__builtin_popcountll(col[j] & col[k]);
+            }
+        }
+        c.trials += kBatch;
+    }
+}
+
+struct Summary {
+    double chi2 = 0; uint64_t dof = 0;
+    double max_dev = 0; // SAC: max |p - 0.5|; BIC: max |phi|
+    double z() const { return dof ? (chi2 - (double)dof) / std::sqrt(2.0 * (double)dof) : 0; }
+};
+
+// SAC cell ~ Binomial(n, 1/2): chi2 = (2c - n)^2 / n, 1 dof per cell
+static Summary sac_summary(const Counters& c) {
+    Summary s;
+    double n = (double)c.trials;
+    for (uint64_t v : c.sac) {
+        double d = 2.0 * (double)v - n;
+        s.chi2 += d * d / n;
+        s.max_dev = std::max(s.max_dev, std::fabs((double)v / n - 0.5));
+        s.dof++;
+    }
+    return s;
+}
+
+// BIC: 2x2 independence test per input bit i and output pair (j,k) over the
+// trials, chi2 = n * phi^2 with 1 dof each. phi gets, for every output pair,
+// the value with the largest |phi| over the input bits
+static Summary bic_summary(const Counters& c, std::vector<double>& phi) {
+    Summary s;
+    double n = (double)c.trials;
+    phi.assign(kBits * kBits, 0.0);
+    for (int i = 0; i < kBits; i++) {
+        const uint64_t* sac_row = &c.sac[i * kBits];
+        const uint64_t* bic_pair = &c.bic[(size_t)i * kPairs];
+        for (int j = 0; j < kBits; j++) {
+            double pj = (double)sac_row[j] / n;
+            for (int k = j + 1; k < kBits; k++) {
+                double pk = (double)sac_row[k] / n;
+                double pjk = (double)*bic_pair++ / n;
+                double den = std::sqrt(pj * (1 - pj) * pk * (1 - pk));
+                double f = den > 0 ? (pjk - pj * pk) / den : 0.0;
+                if (std::fabs(f) > std::fabs(phi[j * kBits + k])) phi[j * kBits + k] = phi[k * kBits + j] = f;
+                s.chi2 += n * f * f;
+                s.max_dev = std::max(s.max_dev, std::fabs(f));
+                s.dof++;
+            }
+        }
+    }
+    return s;
+}
+
+static void dump_csv(const std::string& path, const std::vector<double>& m) {
+    std::ofstream f(path);
+    for (int r = 0; r < kBits; r++) {
+        for (int c = 0; c < kBits; c++) f << (c ? "," : "") << m[r * kBits + c];
+        f << "\n";
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " cipher|hash|rounds=N [trials] [threads] [csv_prefix]\n";
+        return 2;
+    }
+    Target target;
+    std::string what = argv[1];
+    if (what == "hash") target.kind = Target::Hash;
+    else if (what.rfind("rounds=", 0) == 0) target.rounds = std::atoi(what.c_str() + 7);
+    else if (what != "cipher") { std::cerr << "unknown target: " << what << "\n"; return 2; }
+    if (target.rounds < 1 || target.rounds > 18) { std::cerr << "rounds must be 1..18\n"; return 2; }
+
+    uint64_t trials = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100000;
+    if (trials == 0) { std::cerr << "trials must be positive\n"; return 2; }
+    unsigned threads = argc > 3 ? (unsigned)std::atoi(argv[3]) : 0;
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string csv = argc > 4 ? argv[4] : "";
+
+    Clefia128::Key key = {
+        0x00,0x11,0x22,0x33, 0x44,0x55,0x66,0x77,
+        0x88,0x99,0xaa,0xbb, 0xcc,0xdd,0xee,0xff
+    };
+    target.cipher.setKey(key);
+
+    uint64_t batches = (trials + kBatch - 1) / kBatch;
+    std::vector<Counters> per_thread(threads);
+    std::vector<std::thread> pool;
+    auto t0 = std::chrono::steady_clock::now();
+    for (unsigned t = 0; t < threads; t++) {
+        uint64_t mine = batches / threads + (t < batches % threads ? 1 : 0);
+        pool.emplace_back(run_worker, std::cref(target), mine, 0x5eed0000ULL + t, std::ref(per_thread[t]));
+    }
+    for (auto& th : pool) th.join();
+    Counters total;
+    for (const auto& c : per_thread) total.merge(c);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    Summary sac = sac_summary(total);
+    std::vector<double> phi;
+    Summary bic = bic_summary(total, phi);
+
+    std::printf("target=%s trials=%llu threads=%u time=%.1fs\n", what.c_str(),
+                (unsigned long long)total.trials, threads, secs);
+    std::printf("SAC: chi2=%.1f dof=%llu z=%.2f max|p-0.5|=%.5f\n", sac.chi2,
+                (unsigned long long)sac.dof, sac.z(), sac.max_dev);
+    std::printf("BIC: chi2=%.1f dof=%llu z=%.2f max|phi|=%.5f\n", bic.chi2,
+                (unsigned long long)bic.dof, bic.z(), bic.max_dev);
+    // |z| well above ~3 means the matrix deviates from an ideal random function
+    std::printf("verdict: %s\n", (std::fabs(sac.z()) < 4 && std::fabs(bic.z()) < 4) ? "ok" : "weak diffusion");
+
+    if (!csv.empty()) {
+        std::vector<double> sacp(kBits * kBits);
+        for (size_t i = 0; i < sacp.size(); i++) sacp[i] = (double)total.sac[i] / (double)total.trials;
+        dump_csv(csv + "_sac.csv", sacp);
+        dump_csv(csv + "_bic.csv", phi);
+    }
+    return 0;
+}
@@ -0,0 +1,292 @@
+// tools/manifest.cpp
+//
+// File-integrity manifest on clefia128 DM hash.
+//
+//   manifest update <root> <manifest> [threads]   build / refresh the manifest;
+//                                                 files whose size and mtime match
+//                                                 the old manifest are not rehashed
+//   manifest verify <root> <manifest> [threads]   rehash everything and report
+//                                                 changed, missing and new files
+//
+// Files are hashed concurrently on a work-stealing pool: every worker owns a
+// deque of file indices, takes from its back and steals from the front of
+// others when empty. Each worker streams files through its own 1 MiB buffer.
+//
+// Manifest line: <digest hex>\t<size>\t<mtime>\t<path relative to root>
+// mtime is st_mtim in nanoseconds since the Unix epoch; v1 manifests stored
+// raw file_time_type ticks, so their mtimes are ignored and files rehashed.
+
+#include "crypto/hash.hpp"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace crypto;
+
+namespace {
+
+constexpr size_t kReadChunk = 1 << 20;
+const char* const kHeader = "# clefia128-dm manifest v2 mtime=unix-ns";
+const char* const kHeaderV1 = "# clefia128-dm manifest v1";
+constexpr int64_t kNoMtime = INT64_MIN; // never equal to a scanned mtime
+
+struct Entry {
+    std::string path;      // relative, generic format
+    uint64_t size = 0;
+    int64_t mtime = 0;     // ns since the Unix epoch
+    char digest[32] = {};
+    bool failed = false;
+};
+
+// st_mtim is POSIX.1-2008; Darwin names the same field st_mtimespec
+static int64_t mtime_ns(const struct stat& st) {
+#ifdef __APPLE__
+    const struct timespec& t = st.st_mtimespec;
+#else
+    const struct timespec& t = st.st_mtim;
+#endif
+    return (int64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+static std::vector<Entry> scan_tree(const fs::path& root) {
+    std::vector<Entry> out;
+    std::error_code ec;
+    auto opts = fs::directory_options::skip_permission_denied;
+    for (auto it = fs::recursive_directory_iterator(root, opts, ec);
+         !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (!it->is_regular_file(ec)) continue;
+        Entry e;
+        e.path = it->path().lexically_relative(root).generic_string();
+        if (e.path.find('\n') != std::string::npos) {
+            std::cerr << "skip (newline in name): " << it->path() << "\n";
+            continue;
+        }
+        struct stat st;
+        if (::stat(it->path().c_str(), &st) != 0) continue;
+        e.size = (uint64_t)st.st_size;
+        e.mtime = mtime_ns(st);
+        out.push_back(std::move(e));
+    }
+    std::sort(out.begin(), out.end(), [](const Entry& a, const Entry& b) { return a.path < b.path; });
+    return out;
+}
+
+static bool load_manifest(const std::string& path, std::unordered_map<std::string, Entry>& out) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string line;
+    bool v1 = false;
+    while (std::getline(in, line)) {
+        if (line == kHeaderV1) v1 = true;
+        if (line.empty() || line[0] == '#') continue;
+        size_t t1 = line.find('\t'), t2 = line.find('\t', t1 + 1), t3 = line.find('\t', t2 + 1);
+        if (t1 != 32 || t2 == std::string::npos || t3 == std::string::npos) continue;
+        Entry e;
+        std::copy(line.begin(), line.begin() + 32, e.digest);
+        e.size = std::strtoull(line.c_str() + t1 + 1, nullptr, 10);
+        e.mtime = v1 ? kNoMtime : std::strtoll(line.c_str() + t2 + 1, nullptr, 10);
+        e.path = line.substr(t3 + 1);
+        out.emplace(e.path, e);
+    }
+    return true;
+}
+
+static bool save_manifest(const std::string& path, const std::vector<Entry>& entries) {
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary);
+        if (!out) return false;
+        out << kHeader << "\n";
+        std::string line;
+        for (const auto& e : entries) {
+            if (e.failed) continue; // unreadable and not in the old manifest
+            line.assign(e.digest, 32);
+            line += '\t'; line += std::to_string(e.size);
+            line += '\t'; line += std::to_string(e.mtime);
+            line += '\t'; line += e.path;
+            line += '\n';
+            out.write(line.data(), (std::streamsize)line.size());
+        }
+        if (!out) return false;
+    }
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    return !ec;
+}
+
+// false if the file cannot be opened or a read fails before EOF; a digest of
+// the prefix read so far must not end up in the manifest
+static bool hash_file(const fs::path& p, std::vector<uint8_t>& buf, char digest[32]) {
+    std::ifstream in(p, std::ios::binary);
+    if (!in) return false;
+    Clefia128DmHasher h;
+    while (in) {
+        in.read((char*)buf.data(), (std::streamsize)buf.size());
+        if (in.gcount() > 0) h.update(buf.data(), (size_t)in.gcount());
+    }
+    if (in.bad() || !in.eof()) return false;
+    to_hex(h.final(), digest);
+    return true;
+}
+
+// Work-stealing pool over a fixed set of task indices
+class StealingPool {
+public:
+    explicit StealingPool(unsigned n) : queues(n) {}
+
+    void distribute(const std::vector<size_t>& tasks) {
+        // contiguous slices keep neighbouring directories on one worker
+        size_t n = queues.size();
+        for (size_t w = 0; w < n; w++) {
+            size_t b = tasks.size() * w / n, e = tasks.size() * (w + 1) / n;
+            queues[w].items.assign(tasks.begin() + b, tasks.begin() + e);
+        }
+    }
+
+    template <class Fn>
+    void run(Fn fn) {
+        std::vector<std::thread> threads;
+        for (unsigned w = 0; w < queues.size(); w++) {
+            threads.emplace_back([this, w, &fn] {
+                size_t task;
+                while (pop(w, task) || steal(w, task)) fn(w, task);
+            });
+        }
+        for (auto& t : threads) t.join();
+    }
+
+private:
+    struct Queue {
+        std::mutex m;
+        std::deque<size_t> items;
+    };
+    std::vector<Queue> queues;
+
+    bool pop(unsigned w, size_t& task) {
+        std::lock_guard<std::mutex> lock(queues[w].m);
+        if (queues[w].items.empty()) return false;
+        task = queues[w].items.back();
+        queues[w].items.pop_back();
+        return true;
+    }
+    bool steal(unsigned self, size_t& task) {
+        for (size_t k = 1; k < queues.size(); k++) {
+            Queue& q = queues[(self + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(q.m);
+            if (q.items.empty()) continue;
+            task = q.items.front();
+            q.items.pop_front();
+            return true;
+        }
+        return false;
+    }
+};
+
+static void hash_entries(const fs::path& root, std::vector<Entry>& entries,
+                         const std::vector<size_t>& todo, unsigned threads) {
+    StealingPool pool(threads);
+    pool.distribute(todo);
+    std::vector<std::vector<uint8_t>> buffers(threads, std::vector<uint8_t>(kReadChunk));
+    pool.run([&](unsigned w, size_t i) {
+        Entry& e = entries[i];
+        e.failed = !hash_file(root / e.path, buffers[w], e.digest);
+    });
+}
+
+static int usage(const char* argv0) {
+    std::cerr << "usage: " << argv0 << " update|verify <root> <manifest> [threads]\n";
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 4) return usage(argv[0]);
+    std::string mode = argv[1];
+    fs::path root = argv[2];
+    std::string manifest_path = argv[3];
+    unsigned threads = argc > 4 ? (unsigned)std::atoi(argv[4]) : 0;
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    if (mode != "update" && mode != "verify") return usage(argv[0]);
+
+    std::unordered_map<std::string, Entry> old;
+    bool have_old = load_manifest(manifest_path, old);
+    if (mode == "verify" && !have_old) {
+        std::cerr << "cannot read manifest: " << manifest_path << "\n";
+        return 2;
+    }
+
+    std::vector<Entry> entries = scan_tree(root);
+    std::vector<size_t> todo;
+    size_t reused = 0, added = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        Entry& e = entries[i];
+        auto it = old.find(e.path);
+        if (it == old.end()) added++;
+        if (mode == "update" && it != old.end() &&
+            it->second.size == e.size && it->second.mtime == e.mtime) {
+            std::copy(it->second.digest, it->second.digest + 32, e.digest);
+            reused++;
+            continue;
+        }
+        todo.push_back(i);
+    }
+
+    hash_entries(root, entries, todo, threads);
+
+    size_t changed = 0, failed = 0, present = 0;
+    for (auto& e : entries) {
+        auto it = old.find(e.path);
+        if (e.failed) {
+            failed++;
+            std::cerr << "unreadable: " << e.path << "\n";
+            if (it != old.end()) {
+                present++;                             // still there, not removed
+                if (mode == "update") e = it->second;  // keep the last good record
+            }
+            continue;
+        }
+        if (it == old.end()) {
+            if (mode == "verify") std::cout << "new\t" << e.path << "\n";
+            continue;
+        }
+        present++;
+        if (!std::equal(e.digest, e.digest + 32, it->second.digest)) {
+            changed++;
+            if (mode == "verify") std::cout << "changed\t" << e.path << "\n";
+        }
+    }
+    size_t removed = old.size() - present;
+    if (mode == "verify") {
+        std::unordered_map<std::string, bool> seen;
+        for (const auto& e : entries) seen.emplace(e.path, true);
+        for (const auto& kv : old)
+            if (!seen.count(kv.first)) std::cout << "missing\t" << kv.first << "\n";
+    }
+
+    std::fprintf(stderr, "files=%zu hashed=%zu reused=%zu new=%zu changed=%zu removed=%zu unreadable=%zu\n",
+                 entries.size(), todo.size(), reused, added, changed, removed, failed);
+
+    if (mode == "update") {
+        if (!save_manifest(manifest_path, entries)) {
+            std::cerr << "cannot write manifest: " << manifest_path << "\n";
+            return 2;
+        }
+        return 0;
+    }
+    return (changed || removed || added || failed) ? 1 : 0;
+}
@@ -0,0 +1,273 @@
+// bmp.cpp
+
+#include "bmp.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <fcntl.h>
+#include <limits>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Поля заголовков читаются побайтно (little-endian), без невыровненных reinterpret_cast
+static uint16_t readLE16(const unsigned char *p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+static uint32_t readLE32(const unsigned char *p) {
+    return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+           static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+}
+
+bool preadAll(int fd, unsigned char *buf, size_t n, uint64_t off) {
+    while (n > 0) {
+        ssize_t r = pread(fd, buf, n, static_cast<off_t>(off));
+        if (r <= 0) return false;
+        buf += r; n -= static_cast<size_t>(r); off += static_cast<uint64_t>(r);
+    }
+    return true;
+}
+
+bool pwriteAll(int fd, const unsigned char *buf, size_t n, uint64_t off) {
+    while (n > 0) {
+        ssize_t r = pwrite(fd, buf, n, static_cast<off_t>(off));
+        if (r <= 0) return false;
+        buf += r; n -= static_cast<size_t>(r); off += static_cast<uint64_t>(r);
+    }
+    return true;
+}
+
+namespace {
+
+// Дескриптор, закрываемый при выходе из функции
+struct FileFd {
+    int fd;
+    explicit FileFd(int f) : fd(f) {}
+    ~FileFd() { if (fd >= 0) close(fd); }
+    FileFd(const FileFd &) = delete;
+    FileFd &operator=(const FileFd &) = delete;
+};
+
+} // namespace
+
+const size_t kFileHeaderSize = 14;
+const uint32_t kBiRgb = 0, kBiBitfields = 3, kBiAlphaBitfields = 6;
+
+// Чтение заголовков до начала массива пикселей (он начинается с img.header.size())
+static bool readHeader(int fd, uint64_t fileSize, BMPImage &img) {
+    unsigned char fixed[kFileHeaderSize + 4];
+    if (!preadAll(fd, fixed, sizeof(fixed), 0)) return false;
+
+    // Проверка сигнатуры "BM"
+    if (fixed[0] != 'B' || fixed[1] != 'M') return false;
+    uint32_t pixelArrayOffset = readLE32(&fixed[10]);
+    uint32_t infoSize = readLE32(&fixed[14]);
+    // BITMAPCOREHEADER, BITMAPINFOHEADER и V2..V5; у OS/2 2.x (64 байта) поле
+    // сжатия значит другое, прочие размеры не поддерживаются
+    if (infoSize != 12 && infoSize != 40 && infoSize != 52 && infoSize != 56 &&
+        infoSize != 108 && infoSize != 124) return false;
+    if (pixelArrayOffset < kFileHeaderSize + infoSize || pixelArrayOffset > fileSize) return false;
+
+    img.header.resize(pixelArrayOffset);
+    if (!preadAll(fd, img.header.data(), pixelArrayOffset, 0)) return false;
+    const unsigned char *info = img.header.data() + kFileHeaderSize;
+
+    int64_t width, height;
+    uint16_t bitsPerPixel;
+    uint32_t compression = kBiRgb;
+    if (infoSize == 12) {
+        // BITMAPCOREHEADER: 16-битные размеры, всегда bottom-up
+        width = readLE16(&info[4]);
+        height = readLE16(&info[6]);
+        bitsPerPixel = readLE16(&info[10]);
+    } else {
+        width = static_cast<int32_t>(readLE32(&info[4]));
+        height = static_cast<int32_t>(readLE32(&info[8]));
+        bitsPerPixel = readLE16(&info[14]);
+        compression = readLE32(&info[16]);
+    }
+    if (width <= 0 || height == 0 || width > numeric_limits<int32_t>::max() ||
+        height < -int64_t(numeric_limits<int32_t>::max())) return false;
+
+    if (bitsPerPixel == 24 && compression == kBiRgb) {
+        img.layout = PixelLayout::Bgr24;
+    } else if (bitsPerPixel == 32 && compression == kBiRgb) {
+        img.layout = PixelLayout::Bgra32;
+    } else if (bitsPerPixel == 32 && (compression == kBiBitfields || compression == kBiAlphaBitfields)) {
+        // Маски лежат внутри V2+ заголовка либо сразу после BITMAPINFOHEADER
+        size_t masksAt = kFileHeaderSize + 40;
+        if (masksAt + 12 > img.header.size()) return false;
+        const unsigned char *m = img.header.data() + masksAt;
+        if (readLE32(&m[0]) != 0x00FF0000u || readLE32(&m[4]) != 0x0000FF00u ||
+            readLE32(&m[8]) != 0x000000FFu) return false;
+        img.layout = PixelLayout::Bgra32;
+    } else if (bitsPerPixel == 8 && compression == kBiRgb) {
+        img.layout = PixelLayout::Indexed8;
+    } else {
+        return false;
+    }
+
+    img.width = static_cast<int>(width);
+    img.topDown = height < 0;
+    img.height = static_cast<int>(height < 0 ? -height : height);
+    img.rowStride = (static_cast<size_t>(img.width) * bitsPerPixel / 8 + 3) & ~size_t(3);
+
+    uint64_t dataSize = static_cast<uint64_t>(img.rowStride) * static_cast<uint64_t>(img.height);
+    return dataSize <= fileSize - pixelArrayOffset;
+}
+
+// Размер открытого файла; false для ошибки fstat
+static bool fileSizeOf(int fd, uint64_t &size) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) return false;
+    size = static_cast<uint64_t>(st.st_size);
+    return true;
+}
+
+// Ввод-вывод через pread/pwrite, без буферов потоков: повторная загрузка в тот же
+// BMPImage того же размера не выделяет память
+bool loadBMPHeader(const string &filename, BMPImage &img) {
+    FileFd file(::open(filename.c_str(), O_RDONLY));
+    uint64_t fileSize;
+    if (file.fd < 0 || !fileSizeOf(file.fd, fileSize)) return false;
+    return readHeader(file.fd, fileSize, img);
+}
+
+bool loadBMP(const string &filename, BMPImage &img) {
+    FileFd file(::open(filename.c_str(), O_RDONLY));
+    uint64_t fileSize;
+    if (file.fd < 0 || !fileSizeOf(file.fd, fileSize)) return false;
+    if (!readHeader(file.fd, fileSize, img)) return false;
+
+    uint64_t pixelArrayOffset = img.header.size();
+    uint64_t dataSize = static_cast<uint64_t>(img.rowStride) * static_cast<uint64_t>(img.height);
+    img.data.resize(static_cast<size_t>(dataSize));
+    if (!preadAll(file.fd, img.data.data(), img.data.size(), pixelArrayOffset)) return false;
+
+    img.trailer.resize(static_cast<size_t>(fileSize - pixelArrayOffset - dataSize));
+    return preadAll(file.fd, img.trailer.data(), img.trailer.size(), pixelArrayOffset + dataSize);
+}
+
+bool saveBMP(const string &filename, const BMPImage &img) {
+    FileFd file(::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+    if (file.fd < 0) return false;
+    uint64_t off = 0;
+    for (const vector<unsigned char> *part : {&img.header, &img.data, &img.trailer}) {
+        if (!pwriteAll(file.fd, part->data(), part->size(), off)) return false;
+        off += part->size();
+    }
+    int fd = file.fd;
+    file.fd = -1;
+    return close(fd) == 0;
+}
+
+int paletteLsbDelta(const BMPImage &img) {
+    if (img.layout != PixelLayout::Indexed8 || img.header.size() < kFileHeaderSize + 4) return 0;
+    uint32_t infoSize = readLE32(&img.header[kFileHeaderSize]);
+    size_t entryBytes = infoSize == 12 ? 3 : 4;   // RGBTRIPLE у BITMAPCOREHEADER, иначе RGBQUAD
+    size_t paletteAt = kFileHeaderSize + infoSize;
+    if (paletteAt >= img.header.size()) return 0;
+    size_t entries = min<size_t>(256, (img.header.size() - paletteAt) / entryBytes);
+    if (infoSize >= 40) {
+        uint32_t used = readLE32(&img.header[kFileHeaderSize + 32]);
+        if (used != 0) entries = min<size_t>(entries, used);
+    }
+    const unsigned char *pal = img.header.data() + paletteAt;
+    int delta = 0;
+    for (size_t k = 0; k + 1 < entries; k += 2) {
+        for (size_t c = 0; c < 3; ++c) {
+            int d = abs(int(pal[k * entryBytes + c]) - int(pal[(k + 1) * entryBytes + c]));
+            delta = max(delta, d);
+        }
+    }
+    return delta;
+}
+
+const unsigned char *logicalRow(const BMPImage &img, int y) {
+    size_t fileRow = img.topDown ? static_cast<size_t>(y) : static_cast<size_t>(img.height - 1 - y);
+    return img.data.data() + fileRow * img.rowStride;
+}
+
+size_t capacityBits(const BMPImage &img) {
+    size_t pixels = static_cast<size_t>(img.width) * static_cast<size_t>(img.height);
+    switch (img.layout) {
+    case PixelLayout::Bgr24: return pixels * LayoutBgr24::kChannels;
+    case PixelLayout::Bgra32: return pixels * LayoutBgra32::kChannels;
+    case PixelLayout::Indexed8: return pixels * LayoutIndexed8::kChannels;
+    }
+    return 0;
+}
+
+// Курсор по слотам: логическая строка сверху вниз переводится в строку файла
+// один раз на строку через знаковый шаг, внутри строки ветвлений по формату нет
+template <class L>
+struct SlotCursor {
+    unsigned char *row;
+    ptrdiff_t rowStep;
+    int width, x, c;
+
+    SlotCursor(const BMPImage &img, size_t bitPos) {
+        size_t pix = bitPos / L::kChannels;
+        size_t y = pix / static_cast<size_t>(img.width);
+        x = static_cast<int>(pix % static_cast<size_t>(img.width));
+        c = static_cast<int>(bitPos % L::kChannels);
+        width = img.width;
+        unsigned char *base = const_cast<unsigned char*>(img.data.data());
+        if (img.topDown) {
+            row = base + y * img.rowStride;
+            rowStep = static_cast<ptrdiff_t>(img.rowStride);
+        } else {
+            row = base + (static_cast<size_t>(img.height) - 1 - y) * img.rowStride;
+            rowStep = -static_cast<ptrdiff_t>(img.rowStride);
+        }
+    }
+    unsigned char &slot() { return row[x * L::kBytes + L::kOffsets[c]]; }
+    void next() {
+        if (++c == L::kChannels) {
+            c = 0;
+            if (++x == width) { x = 0; row += rowStep; }
+        }
+    }
+};
+
+template <class L>
+static void embedKernel(BMPImage &img, size_t bitPos, const uint8_t *src, size_t n) {
+    SlotCursor<L> cur(img, bitPos);
+    for (size_t i = 0; i < n; ++i) {
+        uint8_t byte = src[i];
+        for (int b = 7; b >= 0; --b) {
+            unsigned char &ch = cur.slot();
+            ch = static_cast<unsigned char>((ch & 0xFE) | ((byte >> b) & 1));
+            cur.next();
+        }
+    }
+}
+
+template <class L>
+static void extractKernel(const BMPImage &img, size_t bitPos, uint8_t *dst, size_t n) {
+    SlotCursor<L> cur(img, bitPos);
+    for (size_t i = 0; i < n; ++i) {
+        unsigned v = 0;
+        for (int b = 0; b < 8; ++b) {
+            v = (v << 1) | (cur.slot() & 1u);
+            cur.next();
+        }
+        dst[i] = static_cast<uint8_t>(v);
+    }
+}
+
+void embedBytes(BMPImage &img, size_t bitPos, const uint8_t *src, size_t n) {
+    switch (img.layout) {
+    case PixelLayout::Bgr24: embedKernel<LayoutBgr24>(img, bitPos, src, n); break;
+    case PixelLayout::Bgra32: embedKernel<LayoutBgra32>(img, bitPos, src, n); break;
+    case PixelLayout::Indexed8: embedKernel<LayoutIndexed8>(img, bitPos, src, n); break;
+    }
+}
+
+void extractBytes(const BMPImage &img, size_t bitPos, uint8_t *dst, size_t n) {
+    switch (img.layout) {
+    case PixelLayout::Bgr24: extractKernel<LayoutBgr24>(img, bitPos, dst, n); break;
+    case PixelLayout::Bgra32: extractKernel<LayoutBgra32>(img, bitPos, dst, n); break;
+    case PixelLayout::Indexed8: extractKernel<LayoutIndexed8>(img, bitPos, dst, n); break;
+    }
+}
@@ -0,0 +1,76 @@
+// bmp.hpp — чтение/запись BMP и LSB-ядра для поддерживаемых раскладок пикселей
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Раскладка пикселя в массиве BMP; для каждой есть своё ядро встраивания/извлечения
+enum class PixelLayout {
+    Bgr24,     // 24 бит, B,G,R — 3 LSB на пиксель
+    Bgra32,    // 32 бит, B,G,R,A — 3 LSB на пиксель, альфа не трогается
+    Indexed8,  // 8 бит с палитрой — 1 LSB (индекса) на пиксель
+};
+
+// Описания раскладок для шаблонных ядер: размер пикселя и смещения каналов
+// в порядке встраивания R->G->B
+struct LayoutBgr24 {
+    static constexpr int kBytes = 3, kChannels = 3;
+    static constexpr int kOffsets[3] = {2, 1, 0};
+};
+struct LayoutBgra32 {
+    static constexpr int kBytes = 4, kChannels = 3;
+    static constexpr int kOffsets[3] = {2, 1, 0};
+};
+struct LayoutIndexed8 {
+    static constexpr int kBytes = 1, kChannels = 1;
+    static constexpr int kOffsets[1] = {0};
+};
+
+struct BMPImage {
+    std::vector<unsigned char> header;   // всё до массива пикселей: заголовки, маски, палитра
+    std::vector<unsigned char> data;     // массив пикселей в порядке файла, с паддингом строк
+    std::vector<unsigned char> trailer;  // всё после массива пикселей (например, ICC-профиль V5)
+    int width = 0;
+    int height = 0;                      // всегда положительная
+    bool topDown = false;                // biHeight < 0
+    PixelLayout layout = PixelLayout::Bgr24;
+    size_t rowStride = 0;                // байт на строку с паддингом до 4
+};
+
+// Разбор BITMAPCOREHEADER / BITMAPINFOHEADER / V2..V5; поддерживаются
+// 24 бит BI_RGB, 32 бит BI_RGB/BI_BITFIELDS (маски BGRA) и 8 бит с палитрой
+bool loadBMP(const std::string &filename, BMPImage &img);
+
+// Только заголовки: размеры, раскладка и вместимость без чтения массива пикселей
+bool loadBMPHeader(const std::string &filename, BMPImage &img);
+
+// Сохраняет заголовок, порядок строк и хвост файла без изменений
+bool saveBMP(const std::string &filename, const BMPImage &img);
+
+// pread/pwrite ровно n байт по смещению off (повторяя при частичных операциях)
+bool preadAll(int fd, unsigned char *buf, size_t n, uint64_t off);
+bool pwriteAll(int fd, const unsigned char *buf, size_t n, uint64_t off);
+
+// Indexed8 меняет LSB индекса, то есть заменяет цвет на соседний по паре (2k, 2k+1)
+// в палитре. Возвращает наибольшее расхождение компонент цвета внутри таких пар
+// (0 для форматов без палитры); при неупорядоченной палитре оно велико, и
+// встраивание даёт заметные скачки цвета
+int paletteLsbDelta(const BMPImage &img);
+
+// Порог, выше которого палитра считается непригодной для LSB-встраивания
+const int kPaletteLsbMaxDelta = 16;
+
+// Начало логической строки y (0 — верхняя) в массиве пикселей
+const unsigned char *logicalRow(const BMPImage &img, int y);
+
+// Число доступных LSB-слотов (бит) контейнера
+size_t capacityBits(const BMPImage &img);
+
+// Запись n байт (биты MSB-first) в LSB, начиная со слота bitPos; порядок слотов —
+// строки сверху вниз, пиксели слева направо, каналы R->G->B
+void embedBytes(BMPImage &img, size_t bitPos, const uint8_t *src, size_t n);
+
+// Чтение n байт из LSB, начиная со слота bitPos
+void extractBytes(const BMPImage &img, size_t bitPos, uint8_t *dst, size_t n);
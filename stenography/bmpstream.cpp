@@ -0,0 +1,165 @@
+// bmpstream.cpp
+
+#include "bmpstream.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+using namespace std;
+
+// Целевой размер полосы; фактически — кратное 8 число строк, но не меньше 8
+const size_t kBandBytes = 1 << 20;
+
+// Копирование [off, off+len) из in в out по тому же смещению без разбора пикселей:
+// copy_file_range, затем sendfile, затем обычный цикл pread/pwrite
+static bool copyRange(int in, int out, uint64_t off, uint64_t len) {
+#ifdef __linux__
+    loff_t inOff = static_cast<loff_t>(off), outOff = static_cast<loff_t>(off);
+    while (len > 0) {
+        ssize_t r = copy_file_range(in, &inOff, out, &outOff, len, 0);
+        if (r <= 0) break;
+        len -= static_cast<uint64_t>(r);
+    }
+    off = static_cast<uint64_t>(inOff);
+    if (len > 0 && lseek(out, static_cast<off_t>(off), SEEK_SET) >= 0) {
+        off_t sfOff = static_cast<off_t>(off);
+        while (len > 0) {
+            ssize_t r = sendfile(out, in, &sfOff, len);
+            if (r <= 0) break;
+            len -= static_cast<uint64_t>(r);
+        }
+        off = static_cast<uint64_t>(sfOff);
+    }
+#endif
+    vector<unsigned char> buf(min<uint64_t>(len, 64 * 1024));
+    while (len > 0) {
+        size_t n = static_cast<size_t>(min<uint64_t>(len, buf.size()));
+        if (!preadAll(in, buf.data(), n, off) || !pwriteAll(out, buf.data(), n, off)) return false;
+        off += n; len -= n;
+    }
+    return true;
+}
+
+BMPStreamBase::~BMPStreamBase() {
+    if (inFd >= 0) close(inFd);
+}
+
+bool BMPStreamBase::openInput(const string &path) {
+    if (!loadBMPHeader(path, img)) return false;
+    inFd = ::open(path.c_str(), O_RDONLY);
+    if (inFd < 0) return false;
+    struct stat st;
+    if (fstat(inFd, &st) != 0) return false;
+    fileSize = static_cast<uint64_t>(st.st_size);
+
+    bandRows = static_cast<int>(max<size_t>(8, kBandBytes / img.rowStride / 8 * 8));
+    band.width = img.width;
+    band.topDown = img.topDown;
+    band.layout = img.layout;
+    band.rowStride = img.rowStride;
+    band.data.reserve(static_cast<size_t>(bandRows) * img.rowStride);
+    return true;
+}
+
+size_t BMPStreamBase::bandSlots() const {
+    BMPImage geom;
+    geom.width = img.width;
+    geom.height = bandRows;
+    geom.layout = img.layout;
+    return ::capacityBits(geom);
+}
+
+// Полоса index покрывает логические строки [index*bandRows, ...) сверху вниз;
+// у bottom-up изображения они лежат в конце массива пикселей
+uint64_t BMPStreamBase::bandOffset(size_t index) const {
+    uint64_t y0 = static_cast<uint64_t>(index) * bandRows;
+    uint64_t y1 = min<uint64_t>(y0 + bandRows, static_cast<uint64_t>(img.height));
+    uint64_t fileRow = img.topDown ? y0 : static_cast<uint64_t>(img.height) - y1;
+    return img.header.size() + fileRow * img.rowStride;
+}
+
+bool BMPStreamBase::loadBand(size_t index) {
+    uint64_t y0 = static_cast<uint64_t>(index) * bandRows;
+    if (y0 >= static_cast<uint64_t>(img.height)) return false;
+    band.height = static_cast<int>(min<uint64_t>(bandRows, static_cast<uint64_t>(img.height) - y0));
+    band.data.resize(static_cast<size_t>(band.height) * img.rowStride);
+    if (!preadAll(inFd, band.data.data(), band.data.size(), bandOffset(index))) return false;
+    bandIndex = index;
+    return true;
+}
+
+BMPStreamWriter::~BMPStreamWriter() {
+    if (outFd >= 0) close(outFd);
+    if (!tmpPath.empty()) unlink(tmpPath.c_str());   // finish() не вызван или не удался
+}
+
+// Результат пишется во временный файл рядом с outPath и переименовывается в finish():
+// outPath может совпадать с inPath, а при ошибке не остаётся пустого или неполного файла
+bool BMPStreamWriter::open(const string &inPath, const string &outPath) {
+    if (!openInput(inPath)) return false;
+    finalPath = outPath;
+    tmpPath = outPath + ".tmp";
+    outFd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (outFd < 0) tmpPath.clear();
+    return outFd >= 0;
+}
+
+bool BMPStreamWriter::flushBand() {
+    if (bandIndex == SIZE_MAX) return true;
+    return pwriteAll(outFd, band.data.data(), band.data.size(), bandOffset(bandIndex));
+}
+
+bool BMPStreamWriter::write(const uint8_t *src, size_t n) {
+    if (bitPos + n * 8 > capacityBits()) return false;
+    const size_t slots = bandSlots();
+    while (n > 0) {
+        size_t index = bitPos / slots;
+        if (index != bandIndex && (!flushBand() || !loadBand(index))) return false;
+        size_t inBand = bitPos - index * slots;
+        size_t m = min(n, (slots - inBand) / 8);
+        embedBytes(band, inBand, src, m);
+        bitPos += m * 8; src += m; n -= m;
+    }
+    return true;
+}
+
+bool BMPStreamWriter::finish() {
+    if (outFd < 0 || !flushBand()) return false;
+    // Затронутые строки образуют непрерывный участок массива пикселей
+    uint64_t pixelStart = img.header.size();
+    uint64_t pixelEnd = pixelStart + static_cast<uint64_t>(img.height) * img.rowStride;
+    uint64_t touchedRows = 0;
+    if (bandIndex != SIZE_MAX)
+        touchedRows = min<uint64_t>(static_cast<uint64_t>(bandIndex + 1) * bandRows, static_cast<uint64_t>(img.height));
+    uint64_t touchedBytes = touchedRows * img.rowStride;
+    uint64_t touchedStart = img.topDown ? pixelStart : pixelEnd - touchedBytes;
+    uint64_t touchedEnd = touchedStart + touchedBytes;
+
+    bool ok = copyRange(inFd, outFd, 0, touchedStart) &&
+              copyRange(inFd, outFd, touchedEnd, fileSize - touchedEnd);
+    ok = close(outFd) == 0 && ok;
+    outFd = -1;
+    if (ok && rename(tmpPath.c_str(), finalPath.c_str()) == 0) tmpPath.clear();
+    else ok = false;
+    return ok;
+}
+
+bool BMPStreamReader::read(uint8_t *dst, size_t n) {
+    if (bitPos + n * 8 > capacityBits()) return false;
+    const size_t slots = bandSlots();
+    while (n > 0) {
+        size_t index = bitPos / slots;
+        if (index != bandIndex && !loadBand(index)) return false;
+        size_t inBand = bitPos - index * slots;
+        size_t m = min(n, (slots - inBand) / 8);
+        extractBytes(band, inBand, dst, m);
+        bitPos += m * 8; dst += m; n -= m;
+    }
+    return true;
+}
@@ -0,0 +1,59 @@
+// bmpstream.hpp — потоковое LSB-встраивание/извлечение полосами строк (POSIX)
+//
+// Массив пикселей не загружается целиком: затрагиваемые строки читаются,
+// изменяются и пишутся полосами через один переиспользуемый буфер, остальная
+// часть файла копируется в ядре (copy_file_range/sendfile). Порядок слотов тот же,
+// что у embedBytes/extractBytes, поэтому результат совместим с обычным режимом.
+
+#pragma once
+#include "bmp.hpp"
+#include <cstdint>
+#include <string>
+
+class BMPStreamBase {
+public:
+    BMPStreamBase() = default;
+    BMPStreamBase(const BMPStreamBase&) = delete;
+    BMPStreamBase &operator=(const BMPStreamBase&) = delete;
+    ~BMPStreamBase();
+
+    const BMPImage &info() const { return img; }
+    size_t capacityBits() const { return ::capacityBits(img); }
+
+protected:
+    bool openInput(const std::string &path);
+    bool loadBand(size_t index);            // читает полосу index в band
+    uint64_t bandOffset(size_t index) const; // смещение полосы в файле
+    size_t bandSlots() const;               // LSB-слотов в полной полосе (кратно 8)
+
+    int inFd = -1;
+    uint64_t fileSize = 0;
+    BMPImage img;        // только заголовок и геометрия
+    BMPImage band;       // текущая полоса: data — переиспользуемый буфер
+    int bandRows = 0;    // строк в полной полосе, кратно 8
+    size_t bandIndex = SIZE_MAX;
+    size_t bitPos = 0;   // позиция в потоке LSB-слотов всего изображения
+};
+
+class BMPStreamWriter : public BMPStreamBase {
+public:
+    ~BMPStreamWriter();
+    // outPath может совпадать с inPath; до успешного finish() он не меняется
+    bool open(const std::string &inPath, const std::string &outPath);
+    bool write(const uint8_t *src, size_t n);
+    // Сбрасывает последнюю полосу, копирует нетронутые части файла и
+    // переименовывает временный файл в outPath
+    bool finish();
+
+private:
+    bool flushBand();
+    int outFd = -1;
+    std::string finalPath;
+    std::string tmpPath;   // пуст, если удалять нечего
+};
+
+class BMPStreamReader : public BMPStreamBase {
+public:
+    bool open(const std::string &inPath) { return openInput(inPath); }
+    bool read(uint8_t *dst, size_t n);
+};
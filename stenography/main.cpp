@@ -1,208 +1,88 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
-#include <bitset>
 #include <string>
 #include <cstdint>
 #include <limits>
+#include <algorithm>
+#include <filesystem>
+#include <iomanip>
 
-using namespace std;
-
-struct BMPHeader {
-    char header[54];
-};
-
-struct Pixel {
-    unsigned char b, g, r;
-};
-
-// Конвертация текста в битовую строку
-string textToBinary(const string &text) {
-    string binary;
-    binary.reserve(text.size() * 8);
-    for (unsigned char c : text) {
-        bitset<8> bits(c);
-        binary += bits.to_string();
-    }
-    return binary;
-}
-
-// Конвертация битовой строки в текст
-string binaryToText(const string &binary) {
-    string message;
-    if (binary.size() % 8 != 0) return message;
-    message.reserve(binary.size() / 8);
-    for (size_t i = 0; i < binary.size(); i += 8) {
-        bitset<8> byte(binary.substr(i, 8));
-        message.push_back(static_cast<char>(byte.to_ulong()));
-    }
-    return message;
-}
-
-// Упаковка 32-битной длины сообщения в битовую строку (big-endian по битам)
-string uint32ToBits(uint32_t val) {
-    string bits;
-    bits.reserve(32);
-    for (int i = 31; i >= 0; --i) {
-        bits.push_back(((val >> i) & 1) ? '1' : '0');
-    }
-    return bits;
-}
-
-// Распаковка 32-битной длины из первых 32 бит
-uint32_t bitsToUint32(const string &bits) {
-    if (bits.size() < 32) return 0;
-    uint32_t val = 0;
-    for (int i = 0; i < 32; ++i) {
-      val = (val << 1) | (bits[i] == '1' ? 1u : 0u);
-    }
-    return val;
-}
-
-bool loadBMP(const string &filename, BMPHeader &header, vector<Pixel> &pixels, int &width, int &height) {
-    ifstream file(filename, ios::binary);
-    if (!file) return false;
-
-    file.read(reinterpret_cast<char*>(&header), sizeof(header));
-    if (!file) return false;
-
-    // Проверка сигнатуры "BM"
-    if (header.header[0] != 'B' || header.header[1] != 'M') return false;
-
-    int pixelArrayOffset = *reinterpret_cast<int*>(&header.header[10]);
-    width  = *reinterpret_cast<int*>(&header.header[18]);
-    height = *reinterpret_cast<int*>(&header.header[22]);
-    short bitsPerPixel = *reinterpret_cast<short*>(&header.header[28]);
-    int compression = *reinterpret_cast<int*>(&header.header[30]);
-
-    // Только несжатый 24-бит BMP
-    if (bitsPerPixel != 24 || compression != 0 || width <= 0 || height == 0) return false;
-
-    int row_padded = (width * 3 + 3) & (~3);
-    file.seekg(pixelArrayOffset, ios::beg);
-
-    pixels.resize(static_cast<size_t>(width) * static_cast<size_t>(abs(height)));
-    vector<unsigned char> row(row_padded);
-
-    // В BMP пиксели хранятся снизу вверх, если height > 0
-    bool bottomUp = height > 0;
-    int absHeight = abs(height);
-
-    for (int i = 0; i < absHeight; i++) {
-        file.read(reinterpret_cast<char*>(row.data()), row_padded);
-        if (!file) return false;
-
-        int destRow = bottomUp ? (absHeight - 1 - i) : i;
-        for (int j = 0; j < width; j++) {
-            Pixel p;
-            p.b = row[j * 3 + 0];
-            p.g = row[j * 3 + 1];
-            p.r = row[j * 3 + 2];
-            pixels[static_cast<size_t>(destRow) * width + j] = p;
-        }
-    }
+#include "bmp.hpp"
+#include "bmpstream.hpp"
+#include "multicarrier.hpp"
+#include "steganalysis.hpp"
+#include "stegocrypt.hpp"
 
-    // Нормализуем высоту как положительную для дальнейшей логики
-    height = absHeight;
-    return true;
-}
-
-bool saveBMP(const string &filename, const BMPHeader &header, const vector<Pixel> &pixels, int width, int height) {
-    ofstream file(filename, ios::binary);
-    if (!file) return false;
-
-    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
-    if (!file) return false;
-
-    int row_padded = (width * 3 + 3) & (~3);
-    vector<unsigned char> row(row_padded, 0);
-
-    // Сохраняем в классическом bottom-up порядке (как в исходнике)
-    for (int i = height - 1; i >= 0; --i) {
-        for (int j = 0; j < width; j++) {
-            const Pixel &p = pixels[static_cast<size_t>(i) * width + j];
-            row[j * 3 + 0] = p.b;
-            row[j * 3 + 1] = p.g;
-            row[j * 3 + 2] = p.r;
-        }
-        // Паддинг уже обнулён в row
-        file.write(reinterpret_cast<const char*>(row.data()), row_padded);
-        if (!file) return false;
-    }
-
-    return true;
-}
-
-// Встраивание битовой строки в LSB (последовательно R->G->B)
-void embedBits(vector<Pixel> &pixels, const string &bits) {
-    size_t bitIndex = 0, total = bits.size();
-    for (auto &px : pixels) {
-        if (bitIndex < total) { px.r = (px.r & 0xFE) | (bits[bitIndex++] - '0'); }
-        if (bitIndex < total) { px.g = (px.g & 0xFE) | (bits[bitIndex++] - '0'); }
-        if (bitIndex < total) { px.b = (px.b & 0xFE) | (bits[bitIndex++] - '0'); }
-        if (bitIndex >= total) break;
-    }
-}
-
-// Извлечение указанного числа бит из LSB
-string extractBits(const vector<Pixel> &pixels, size_t bitsToRead) {
-    string bits;
-    bits.reserve(bitsToRead);
-    for (const auto &px : pixels) {
-        if (bits.size() < bitsToRead) bits.push_back((px.r & 1) ? '1' : '0');
-        if (bits.size() < bitsToRead) bits.push_back((px.g & 1) ? '1' : '0');
-        if (bits.size() < bitsToRead) bits.push_back((px.b & 1) ? '1' : '0');
-        if (bits.size() >= bitsToRead) break;
-    }
-    return bits;
-}
+using namespace std;
 
 // Полная процедура встраивания: [32 бита длины в байтах] + [сообщение]
-bool embedMessage(vector<Pixel> &pixels, const string &message, string &error) {
-    string msgBits = textToBinary(message);                 // N*8 бит
+bool embedMessage(BMPImage &img, const string &message, string &error) {
     uint32_t msgLenBytes = static_cast<uint32_t>(message.size());
-    string lenBits = uint32ToBits(msgLenBytes);             // 32 бита
-    string allBits = lenBits + msgBits;                     // Всего 32 + N*8 бит
-
-    // Вместимость: 3 бита на пиксель
-    size_t capacityBits = pixels.size() * 3;
-    if (allBits.size() > capacityBits) {
-        error = "Сообщение слишком длинное для данного контейнера (вместимость: " + to_string(capacityBits/8) + " байт с учётом длины).";
+    size_t capacity = capacityBits(img);
+    if (32 + static_cast<uint64_t>(message.size()) * 8 > capacity) {
+        error = "Сообщение слишком длинное для данного контейнера (вместимость: " + to_string(capacity/8) + " байт с учётом длины).";
         return false;
     }
-    embedBits(pixels, allBits);
+    uint8_t lenBytes[4];
+    uint32ToBytes(msgLenBytes, lenBytes);
+    embedBytes(img, 0, lenBytes, 4);
+    embedBytes(img, 32, reinterpret_cast<const uint8_t*>(message.data()), message.size());
     return true;
 }
 
-// Полная процедура извлечения: сначала читаем 32 бита длины, затем читаем message_len*8 бит
-bool extractMessage(const vector<Pixel> &pixels, string &outMessage, string &error) {
-    // Сначала достанем 32 бита длины
-    string lenBits = extractBits(pixels, 32);
-    if (lenBits.size() < 32) {
+// Полная процедура извлечения: сначала читаем 32 бита длины, затем message_len*8 бит
+bool extractMessage(const BMPImage &img, string &outMessage, string &error) {
+    size_t capacity = capacityBits(img);
+    if (capacity < 32) {
         error = "Недостаточно данных для чтения длины сообщения.";
         return false;
     }
-    uint32_t msgLenBytes = bitsToUint32(lenBits);
-    // Затем читаем нужное число бит
-    size_t msgBitsCount = static_cast<size_t>(msgLenBytes) * 8;
-    string msgBits = extractBits(pixels, 32 + msgBitsCount);
-    if (msgBits.size() < 32 + msgBitsCount) {
+    uint8_t lenBytes[4];
+    extractBytes(img, 0, lenBytes, 4);
+    uint32_t msgLenBytes = bytesToUint32(lenBytes);
+    if (32 + static_cast<uint64_t>(msgLenBytes) * 8 > capacity) {
         error = "Недостаточно данных для извлечения полного сообщения.";
         return false;
     }
-    // Обрезаем только сообщение после первых 32 бит
-    string onlyMsgBits = msgBits.substr(32);
-    outMessage = binaryToText(onlyMsgBits);
+    outMessage.resize(msgLenBytes);
+    extractBytes(img, 32, reinterpret_cast<uint8_t*>(&outMessage[0]), msgLenBytes);
     return true;
 }
 
+// Предупреждение для 8-битных контейнеров, чья палитра не упорядочена по парам
+void warnPalette(const BMPImage &img, const string &path) {
+    int delta = paletteLsbDelta(img);
+    if (delta > kPaletteLsbMaxDelta) {
+        cout << "Внимание: " << path << " — палитра не упорядочена (цвета в парах индексов различаются до "
+             << delta << "), внедрение даст заметные скачки цвета.\n";
+    }
+}
+
+// Список BMP: сам файл либо все *.bmp в каталоге (рекурсивно, по алфавиту)
+vector<string> collectBMPs(const string &path) {
+    namespace fs = std::filesystem;
+    vector<string> files;
+    error_code ec;
+    if (!fs::is_directory(path, ec)) {
+        files.push_back(path);
+        return files;
+    }
+    for (auto it = fs::recursive_directory_iterator(path, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (!it->is_regular_file(ec)) continue;
+        string ext = it->path().extension().string();
+        for (auto &ch : ext) ch = static_cast<char>(tolower(static_cast<unsigned char>(ch)));
+        if (ext == ".bmp") files.push_back(it->path().string());
+    }
+    sort(files.begin(), files.end());
+    return files;
+}
+
 int main() {
     //ios::sync_with_stdio(false);
     //cin.tie(nullptr);
 
-    BMPHeader header;
-    vector<Pixel> pixels;
-    int width = 0, height = 0;
+    BMPImage img;
     string inputFile, outputFile;
 
     int choice;
@@ -211,6 +91,13 @@ int main() {
         cout << "1. Внедрить сообщение\n";
         cout << "2. Извлечь сообщение\n";
         cout << "3. Выйти\n";
+        cout << "4. Зашифровать файл (CLEFIA-128 CTR) и внедрить\n";
+        cout << "5. Извлечь и расшифровать файл (CLEFIA-128 CTR)\n";
+        cout << "6. Стегоанализ BMP (файл или каталог)\n";
+        cout << "7. Внедрить файл в несколько контейнеров\n";
+        cout << "8. Собрать файл из нескольких контейнеров\n";
+        cout << "9. Потоково зашифровать и внедрить файл (BMP больше памяти)\n";
+        cout << "10. Потоково извлечь и расшифровать файл (BMP больше памяти)\n";
         cout << "Выберите опцию: ";
         if (!(cin >> choice)) return 0;
         cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
@@ -219,17 +106,18 @@ int main() {
             cout << "Введите путь к BMP-файлу (контейнер): ";
             getline(cin, inputFile);
 
-            if (!loadBMP(inputFile, header, pixels, width, height)) {
-                cout << "Не удалось загрузить BMP или формат не поддерживается (ожидается несжатый 24-бит BMP).\n";
+            if (!loadBMP(inputFile, img)) {
+                cout << "Не удалось загрузить BMP или формат не поддерживается (ожидается несжатый BMP 24/32 бит или 8 бит с палитрой).\n";
                 continue;
             }
 
+            warnPalette(img, inputFile);
             cout << "Введите сообщение для внедрения: ";
             string message;
             getline(cin, message);
 
             string err;
-            if (!embedMessage(pixels, message, err)) {
+            if (!embedMessage(img, message, err)) {
                 cout << "Ошибка внедрения: " << err << "\n";
                 continue;
             }
@@ -237,7 +125,7 @@ int main() {
             cout << "Введите путь для сохранения выходного BMP: ";
             getline(cin, outputFile);
 
-            if (saveBMP(outputFile, header, pixels, width, height)) {
+            if (saveBMP(outputFile, img)) {
                 cout << "Сообщение успешно внедрено и сохранено в: " << outputFile << "\n";
             } else {
                 cout << "Ошибка при сохранении файла.\n";
@@ -247,18 +135,191 @@ int main() {
             cout << "Введите путь к BMP-файлу со скрытым сообщением: ";
             getline(cin, inputFile);
 
-            if (!loadBMP(inputFile, header, pixels, width, height)) {
-                cout << "Не удалось загрузить BMP или формат не поддерживается (ожидается несжатый 24-бит BMP).\n";
+            if (!loadBMP(inputFile, img)) {
+                cout << "Не удалось загрузить BMP или формат не поддерживается (ожидается несжатый BMP 24/32 бит или 8 бит с палитрой).\n";
                 continue;
             }
 
             string extracted, err;
-            if (extractMessage(pixels, extracted, err)) {
+            if (extractMessage(img, extracted, err)) {
                 cout << "Извлечённое сообщение: " << extracted << "\n";
             } else {
                 cout << "Не удалось извлечь сообщение: " << err << "\n";
             }
 
+        } else if (choice == 4 || choice == 5) {
+            cout << "Введите путь к BMP-файлу (контейнер): ";
+            getline(cin, inputFile);
+
+            if (!loadBMP(inputFile, img)) {
+                cout << "Не удалось загрузить BMP или формат не поддерживается (ожидается несжатый BMP 24/32 бит или 8 бит с палитрой).\n";
+                continue;
+            }
+
+            cout << "Введите ключ CLEFIA-128 (32 hex-символа): ";
+            string keyHex;
+            getline(cin, keyHex);
+            crypto::Clefia128::Key key{};
+            if (!parseKeyHex(keyHex, key)) {
+                cout << "Некорректный ключ.\n";
+                continue;
+            }
+
+            string err;
+            if (choice == 4) {
+                warnPalette(img, inputFile);
+                cout << "Введите путь к файлу с данными: ";
+                string payloadFile;
+                getline(cin, payloadFile);
+
+                ImageLsbWriter writer{img};
+                if (!embedEncryptedFile(writer, payloadFile, key, randomIv(), err)) {
+                    cout << "Ошибка внедрения: " << err << "\n";
+                    continue;
+                }
+
+                cout << "Введите путь для сохранения выходного BMP: ";
+                getline(cin, outputFile);
+
+                if (saveBMP(outputFile, img)) {
+                    cout << "Файл зашифрован, внедрён и сохранён в: " << outputFile << "\n";
+                } else {
+                    cout << "Ошибка при сохранении файла.\n";
+                }
+            } else {
+                cout << "Введите путь для сохранения расшифрованного файла: ";
+                getline(cin, outputFile);
+
+                ImageLsbReader reader{img};
+                if (extractEncryptedFile(reader, outputFile, key, err)) {
+                    cout << "Файл извлечён и расшифрован в: " << outputFile << "\n";
+                } else {
+                    cout << "Не удалось извлечь файл: " << err << "\n";
+                }
+            }
+
+        } else if (choice == 6) {
+            cout << "Введите путь к BMP-файлу или каталогу: ";
+            getline(cin, inputFile);
+
+            vector<string> files = collectBMPs(inputFile);
+            vector<StegoReport> reports = analyzeFiles(files);
+
+            size_t suspicious = 0;
+            cout << fixed << setprecision(3);
+            for (const auto &r : reports) {
+                if (!r.ok) {
+                    cout << r.path << "\tне удалось загрузить\n";
+                    continue;
+                }
+                double rate = max(r.chiRate, r.rsRate);
+                if (rate > 0.05) ++suspicious;
+                cout << r.path << "\tchi2 p=" << r.chiSquareP << "\tchi-rate=" << r.chiRate
+                     << "\tRS-rate=" << r.rsRate << "\n";
+            }
+            cout.unsetf(ios::fixed);
+            cout << "Проанализировано файлов: " << reports.size() << ", подозрительных (оценка > 5%): " << suspicious << "\n";
+
+        } else if (choice == 7) {
+            cout << "Введите путь к каталогу с контейнерами (или к BMP-файлу): ";
+            getline(cin, inputFile);
+            vector<string> carriers = collectBMPs(inputFile);
+
+            cout << "Введите путь к файлу с данными: ";
+            string payloadFile;
+            getline(cin, payloadFile);
+            error_code ec;
+            uint64_t payloadSize = std::filesystem::file_size(payloadFile, ec);
+            if (ec) {
+                cout << "Не удалось открыть файл с данными.\n";
+                continue;
+            }
+
+            cout << "Введите каталог для сохранения выходных BMP: ";
+            getline(cin, outputFile);
+
+            vector<FragmentPlan> plan;
+            string err;
+            if (!planFragments(carriers, outputFile, payloadSize, plan, err) ||
+                !embedFragments(plan, payloadFile, err)) {
+                cout << "Ошибка внедрения: " << err << "\n";
+                continue;
+            }
+            BMPImage header;
+            for (const auto &p : plan) {
+                if (loadBMPHeader(p.carrier, header)) warnPalette(header, p.carrier);
+                cout << "  фрагмент " << p.header.index + 1 << "/" << p.header.count << ": "
+                     << p.header.size << " байт -> " << p.output << "\n";
+            }
+            cout << "Файл внедрён в " << plan.size() << " контейнер(ов).\n";
+
+        } else if (choice == 8) {
+            cout << "Введите путь к каталогу (или BMP-файлу) с фрагментами: ";
+            getline(cin, inputFile);
+
+            cout << "Введите путь для сохранения собранного файла: ";
+            getline(cin, outputFile);
+
+            string err;
+            if (assembleFragments(collectBMPs(inputFile), outputFile, err)) {
+                cout << "Файл собран и сохранён в: " << outputFile << "\n";
+            } else {
+                cout << "Не удалось собрать файл: " << err << "\n";
+            }
+
+        } else if (choice == 9 || choice == 10) {
+            cout << "Введите путь к BMP-файлу (контейнер): ";
+            getline(cin, inputFile);
+
+            cout << "Введите ключ CLEFIA-128 (32 hex-символа): ";
+            string keyHex;
+            getline(cin, keyHex);
+            crypto::Clefia128::Key key{};
+            if (!parseKeyHex(keyHex, key)) {
+                cout << "Некорректный ключ.\n";
+                continue;
+            }
+
+            string err;
+            if (choice == 9) {
+                cout << "Введите путь к файлу с данными: ";
+                string payloadFile;
+                getline(cin, payloadFile);
+
+                cout << "Введите путь для сохранения выходного BMP: ";
+                getline(cin, outputFile);
+
+                BMPStreamWriter writer;
+                if (!writer.open(inputFile, outputFile)) {
+                    cout << "Не удалось открыть BMP или формат не поддерживается (ожидается несжатый BMP 24/32 бит или 8 бит с палитрой).\n";
+                    continue;
+                }
+                warnPalette(writer.info(), inputFile);
+                if (!embedEncryptedFile(writer, payloadFile, key, randomIv(), err)) {
+                    cout << "Ошибка внедрения: " << err << "\n";
+                    continue;
+                }
+                if (writer.finish()) {
+                    cout << "Файл зашифрован, внедрён и сохранён в: " << outputFile << "\n";
+                } else {
+                    cout << "Ошибка при сохранении файла.\n";
+                }
+            } else {
+                cout << "Введите путь для сохранения расшифрованного файла: ";
+                getline(cin, outputFile);
+
+                BMPStreamReader reader;
+                if (!reader.open(inputFile)) {
+                    cout << "Не удалось открыть BMP или формат не поддерживается (ожидается несжатый BMP 24/32 бит или 8 бит с палитрой).\n";
+                    continue;
+                }
+                if (extractEncryptedFile(reader, outputFile, key, err)) {
+                    cout << "Файл извлечён и расшифрован в: " << outputFile << "\n";
+                } else {
+                    cout << "Не удалось извлечь файл: " << err << "\n";
+                }
+            }
+
         } else if (choice != 3) {
             cout << "Неверный выбор, попробуйте снова.\n";
         }
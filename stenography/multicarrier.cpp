@@ -0,0 +1,326 @@
+// multicarrier.cpp
+
+#include "multicarrier.hpp"
+#include "bmp.hpp"
+#include "bmpstream.hpp"
+#include <algorithm>
+#include <atomic>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+static const uint8_t kFragmentMagic[4] = {'L', 'S', 'B', 'F'};
+
+// Размер порции при копировании фрагмента из файла в LSB
+const size_t kFragmentChunk = 64 * 1024;
+
+static void putBE(uint8_t *p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) p[i] = static_cast<uint8_t>(v >> (8 * (bytes - 1 - i)));
+}
+static uint64_t getBE(const uint8_t *p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; ++i) v = (v << 8) | p[i];
+    return v;
+}
+
+// [сигнатура 4][id 8][index 4][count 4][totalSize 8][offset 8][size 4]
+static void packHeader(const FragmentHeader &h, uint8_t out[kFragmentHeaderBytes]) {
+    copy(begin(kFragmentMagic), end(kFragmentMagic), out);
+    putBE(out + 4, h.payloadId, 8);
+    putBE(out + 12, h.index, 4);
+    putBE(out + 16, h.count, 4);
+    putBE(out + 20, h.totalSize, 8);
+    putBE(out + 28, h.offset, 8);
+    putBE(out + 36, h.size, 4);
+}
+
+static bool unpackHeader(const uint8_t in[kFragmentHeaderBytes], FragmentHeader &h) {
+    if (!equal(begin(kFragmentMagic), end(kFragmentMagic), in)) return false;
+    h.payloadId = getBE(in + 4, 8);
+    h.index = static_cast<uint32_t>(getBE(in + 12, 4));
+    h.count = static_cast<uint32_t>(getBE(in + 16, 4));
+    h.totalSize = getBE(in + 20, 8);
+    h.offset = getBE(in + 28, 8);
+    h.size = static_cast<uint32_t>(getBE(in + 36, 4));
+    return h.index < h.count && h.offset <= h.totalSize && h.size <= h.totalSize - h.offset;
+}
+
+bool planFragments(const vector<string> &carriers, const string &outDir,
+                   uint64_t payloadSize, vector<FragmentPlan> &plan, string &error) {
+    namespace fs = std::filesystem;
+    plan.clear();
+    set<string> names;
+    BMPImage img;
+    vector<uint64_t> room;   // байт под данные в каждом контейнере плана
+    uint64_t totalRoom = 0;
+    for (const auto &carrier : carriers) {
+        if (!loadBMPHeader(carrier, img)) continue;
+        uint64_t capacityBytes = capacityBits(img) / 8;
+        if (capacityBytes <= kFragmentHeaderBytes) continue;
+
+        string name = fs::path(carrier).filename().string();
+        if (!names.insert(name).second) {
+            error = "Повторяющееся имя контейнера: " + name + ".";
+            return false;
+        }
+        FragmentPlan p;
+        p.carrier = carrier;
+        p.output = (fs::path(outDir) / name).string();
+        plan.push_back(p);
+        room.push_back(min<uint64_t>(capacityBytes - kFragmentHeaderBytes, numeric_limits<uint32_t>::max()));
+        totalRoom += room.back();
+    }
+    if (plan.empty() || totalRoom < payloadSize) {
+        error = "Недостаточно вместимости контейнеров (доступно: " + to_string(totalRoom) +
+                " байт, нужно: " + to_string(payloadSize) + ").";
+        plan.clear();
+        return false;
+    }
+
+    // Доли пропорциональны вместимости (одинаковая доля занятых LSB во всех контейнерах);
+    // остаток от округления раздаётся по порядку туда, где ещё есть место
+    vector<uint64_t> sizes(plan.size());
+    uint64_t assigned = 0;
+    for (size_t i = 0; i < plan.size(); ++i) {
+        long double share = static_cast<long double>(payloadSize) * room[i] / totalRoom;
+        sizes[i] = min<uint64_t>(room[i], static_cast<uint64_t>(share));
+        assigned += sizes[i];
+    }
+    for (size_t i = 0; i < plan.size() && assigned < payloadSize; ++i) {
+        uint64_t add = min(room[i] - sizes[i], payloadSize - assigned);
+        sizes[i] += add;
+        assigned += add;
+    }
+
+    // Контейнеры с пустыми долями не нужны (кроме единственного для пустого файла)
+    vector<FragmentPlan> used;
+    uint64_t offset = 0;
+    for (size_t i = 0; i < plan.size(); ++i) {
+        if (sizes[i] == 0 && !(payloadSize == 0 && used.empty())) continue;
+        plan[i].header.offset = offset;
+        plan[i].header.size = static_cast<uint32_t>(sizes[i]);
+        offset += sizes[i];
+        used.push_back(plan[i]);
+    }
+    plan.swap(used);
+
+    random_device rd;
+    uint64_t id = (static_cast<uint64_t>(rd()) << 32) | rd();
+    for (size_t i = 0; i < plan.size(); ++i) {
+        plan[i].header.payloadId = id;
+        plan[i].header.index = static_cast<uint32_t>(i);
+        plan[i].header.count = static_cast<uint32_t>(plan.size());
+        plan[i].header.totalSize = payloadSize;
+    }
+    return true;
+}
+
+// Общий пул: потоки разбирают задачи по атомарному счётчику, первая ошибка останавливает остальных
+template <class Fn>
+static void runParallel(size_t tasks, unsigned threads, Fn fn) {
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+    threads = static_cast<unsigned>(min<size_t>(threads, max<size_t>(tasks, 1)));
+    atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next.fetch_add(1); i < tasks; i = next.fetch_add(1)) {
+            if (!fn(i)) break;
+        }
+    };
+    vector<thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto &th : pool) th.join();
+}
+
+bool embedFragments(const vector<FragmentPlan> &plan, const string &payloadPath,
+                    string &error, unsigned threads) {
+    namespace fs = std::filesystem;
+    mutex errMutex;
+    atomic<bool> failed{false};
+    auto fail = [&](const string &msg) {
+        lock_guard<mutex> lock(errMutex);
+        if (!failed.exchange(true)) error = msg;
+        return false;
+    };
+
+    // Каталог для результатов создаётся заранее; выход, совпадающий с контейнером,
+    // при откате не удаляется — иначе пропал бы исходный файл
+    vector<char> inPlace(plan.size()), written(plan.size());
+    for (size_t i = 0; i < plan.size(); ++i) {
+        error_code ec;
+        fs::path dir = fs::path(plan[i].output).parent_path();
+        if (!dir.empty() && !fs::create_directories(dir, ec) && ec) {
+            error = "Не удалось создать каталог " + dir.string() + ".";
+            return false;
+        }
+        inPlace[i] = fs::equivalent(plan[i].carrier, plan[i].output, ec);
+    }
+
+    runParallel(plan.size(), threads, [&](size_t i) {
+        if (failed) return false;
+        const FragmentPlan &p = plan[i];
+        BMPImage img;
+        if (!loadBMP(p.carrier, img)) return fail("Не удалось загрузить контейнер " + p.carrier + ".");
+
+        uint8_t hdr[kFragmentHeaderBytes];
+        packHeader(p.header, hdr);
+        embedBytes(img, 0, hdr, sizeof(hdr));
+
+        ifstream in(payloadPath, ios::binary);
+        if (!in) return fail("Не удалось открыть файл с данными.");
+        in.seekg(static_cast<streamoff>(p.header.offset), ios::beg);
+        vector<uint8_t> chunk(kFragmentChunk);
+        size_t bitPos = kFragmentHeaderBytes * 8;
+        uint64_t left = p.header.size;
+        while (left > 0) {
+            size_t n = static_cast<size_t>(min<uint64_t>(left, chunk.size()));
+            if (!in.read(reinterpret_cast<char*>(chunk.data()), static_cast<streamsize>(n)))
+                return fail("Ошибка чтения файла с данными.");
+            embedBytes(img, bitPos, chunk.data(), n);
+            bitPos += n * 8;
+            left -= n;
+        }
+        written[i] = 1;
+        if (!saveBMP(p.output, img)) return fail("Ошибка при сохранении " + p.output + ".");
+        return true;
+    });
+    // Неполный набор фрагментов не оставляем
+    if (failed) {
+        for (size_t i = 0; i < plan.size(); ++i) {
+            if (written[i] && !inPlace[i]) ::unlink(plan[i].output.c_str());
+        }
+    }
+    return !failed;
+}
+
+struct FoundFragment {
+    bool ok = false;
+    FragmentHeader header;
+};
+
+bool assembleFragments(const vector<string> &files, const string &outPath,
+                       string &error, unsigned threads) {
+    // Проход 1: только заголовки фрагментов (первые строки изображения)
+    vector<FoundFragment> found(files.size());
+    runParallel(files.size(), threads, [&](size_t i) {
+        BMPStreamReader reader;
+        if (!reader.open(files[i]) || reader.capacityBits() / 8 < kFragmentHeaderBytes) return true;
+        uint8_t hdr[kFragmentHeaderBytes];
+        FoundFragment &f = found[i];
+        if (!reader.read(hdr, sizeof(hdr)) || !unpackHeader(hdr, f.header) ||
+            f.header.size > reader.capacityBits() / 8 - kFragmentHeaderBytes) return true;
+        f.ok = true;
+        return true;
+    });
+
+    // Группировка по payloadId; берём первый полный набор
+    map<uint64_t, map<uint32_t, size_t>> byId;   // id -> номер фрагмента -> файл
+    for (size_t i = 0; i < found.size(); ++i) {
+        if (found[i].ok) byId[found[i].header.payloadId].emplace(found[i].header.index, i);
+    }
+    if (byId.empty()) {
+        error = "Фрагменты не найдены.";
+        return false;
+    }
+    const map<uint32_t, size_t> *best = nullptr;
+    for (const auto &kv : byId) {
+        const auto &frags = kv.second;
+        if (frags.size() == found[frags.begin()->second].header.count) { best = &frags; break; }
+        if (!best || frags.size() > best->size()) best = &frags;
+    }
+
+    // Все заголовки набора должны описывать один и тот же файл
+    const FragmentHeader &first = found[best->begin()->second].header;
+    for (const auto &kv : *best) {
+        const FragmentHeader &h = found[kv.second].header;
+        if (h.count != first.count || h.totalSize != first.totalSize) {
+            error = "Фрагменты не согласованы: разное число фрагментов или размер файла.";
+            return false;
+        }
+    }
+    uint32_t count = first.count;
+    if (best->size() != count) {
+        string missing;
+        size_t listed = 0;
+        for (uint32_t i = 0; i < count && listed < 20; ++i) {
+            if (best->count(i)) continue;
+            if (!missing.empty()) missing += ", ";
+            missing += to_string(i + 1);
+            ++listed;
+        }
+        if (count - best->size() > listed) missing += ", ...";
+        error = "Не хватает фрагментов " + missing + " из " + to_string(count) + ".";
+        return false;
+    }
+
+    // Участки [offset, offset+size) должны покрывать файл ровно один раз; выход за
+    // totalSize отсекается ещё в unpackHeader
+    vector<pair<uint64_t, uint64_t>> ranges;
+    for (const auto &kv : *best) {
+        const FragmentHeader &h = found[kv.second].header;
+        ranges.emplace_back(h.offset, h.size);
+    }
+    sort(ranges.begin(), ranges.end());
+    uint64_t covered = 0;
+    for (const auto &r : ranges) {
+        if (r.first != covered) {
+            error = r.first < covered ? "Фрагменты перекрываются." : "Фрагменты не покрывают файл целиком.";
+            return false;
+        }
+        covered += r.second;
+    }
+    if (covered != first.totalSize) {
+        error = "Фрагменты не согласованы по размеру.";
+        return false;
+    }
+
+    // Проход 2: каждый фрагмент пишется сразу на своё место; память — порция на поток
+    int outFd = ::open(outPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (outFd < 0) {
+        error = "Не удалось открыть выходной файл.";
+        return false;
+    }
+    vector<size_t> order;
+    for (const auto &kv : *best) order.push_back(kv.second);
+    mutex errMutex;
+    atomic<bool> failed{false};
+    auto fail = [&](const string &msg) {
+        lock_guard<mutex> lock(errMutex);
+        if (!failed.exchange(true)) error = msg;
+        return false;
+    };
+    runParallel(order.size(), threads, [&](size_t k) {
+        if (failed) return false;
+        const string &path = files[order[k]];
+        const FragmentHeader &h = found[order[k]].header;
+        BMPStreamReader reader;
+        uint8_t hdr[kFragmentHeaderBytes];
+        if (!reader.open(path) || !reader.read(hdr, sizeof(hdr)))
+            return fail("Не удалось прочитать контейнер " + path + ".");
+        vector<uint8_t> chunk(kFragmentChunk);
+        uint64_t pos = h.offset, left = h.size;
+        while (left > 0) {
+            size_t n = static_cast<size_t>(min<uint64_t>(left, chunk.size()));
+            if (!reader.read(chunk.data(), n)) return fail("Не удалось прочитать контейнер " + path + ".");
+            if (!pwriteAll(outFd, chunk.data(), n, pos)) return fail("Ошибка записи выходного файла.");
+            pos += n;
+            left -= n;
+        }
+        return true;
+    });
+    if (close(outFd) != 0) fail("Ошибка записи выходного файла.");
+    if (failed) {
+        ::unlink(outPath.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,44 @@
+// multicarrier.hpp — разбиение файла на фрагменты по нескольким контейнерам
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Заголовок фрагмента, записываемый в начало LSB-потока каждого контейнера
+struct FragmentHeader {
+    uint64_t payloadId = 0;   // общий для всех фрагментов одного файла
+    uint32_t index = 0;       // номер фрагмента
+    uint32_t count = 0;       // всего фрагментов
+    uint64_t totalSize = 0;   // размер исходного файла
+    uint64_t offset = 0;      // смещение фрагмента в исходном файле
+    uint32_t size = 0;        // байт в этом фрагменте
+};
+
+// Размер заголовка фрагмента в байтах LSB-потока (с сигнатурой)
+const size_t kFragmentHeaderBytes = 40;
+
+struct FragmentPlan {
+    std::string carrier;      // входной контейнер
+    std::string output;       // куда сохранить результат
+    FragmentHeader header;
+};
+
+// Раскладка файла payloadSize по контейнерам в заданном порядке: доли пропорциональны
+// вместимости, остаток от округления — первым контейнерам со свободным местом;
+// контейнеры без места для заголовка и с нулевой долей пропускаются
+bool planFragments(const std::vector<std::string> &carriers, const std::string &outDir,
+                   uint64_t payloadSize, std::vector<FragmentPlan> &plan, std::string &error);
+
+// Параллельное внедрение фрагментов файла payloadPath по плану; threads == 0 — по числу ядер.
+// Каталог результатов создаётся при необходимости; при ошибке уже записанные
+// результаты удаляются (кроме перезаписанных на месте контейнеров)
+bool embedFragments(const std::vector<FragmentPlan> &plan, const std::string &payloadPath,
+                    std::string &error, unsigned threads = 0);
+
+// Сборка файла из любых контейнеров (в любом порядке, лишние игнорируются): каждый
+// фрагмент пишется сразу по своему смещению, в памяти держатся только заголовки.
+// Набор отвергается, если его заголовки расходятся по count/totalSize или участки
+// перекрываются; при ошибке выходной файл удаляется
+bool assembleFragments(const std::vector<std::string> &files, const std::string &outPath,
+                       std::string &error, unsigned threads = 0);
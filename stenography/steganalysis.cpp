@@ -0,0 +1,199 @@
+// steganalysis.cpp
+
+#include "steganalysis.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+using namespace std;
+
+// Верхняя регуляризованная неполная гамма-функция Q(a, x) (ряд / цепная дробь)
+static double gammaQ(double a, double x) {
+    if (x <= 0) return 1.0;
+    double gln = lgamma(a);
+    if (x < a + 1) {
+        double ap = a, sum = 1.0 / a, del = sum;
+        for (int n = 0; n < 500; ++n) {
+            ap += 1;
+            del *= x / ap;
+            sum += del;
+            if (fabs(del) < fabs(sum) * 1e-12) break;
+        }
+        return 1.0 - sum * exp(-x + a * log(x) - gln);
+    }
+    const double tiny = 1e-300;
+    double b = x + 1 - a, c = 1 / tiny, d = 1 / b, h = d;
+    for (int i = 1; i < 500; ++i) {
+        double an = -i * (i - a);
+        b += 2;
+        d = an * d + b; if (fabs(d) < tiny) d = tiny;
+        c = b + an / c; if (fabs(c) < tiny) c = tiny;
+        d = 1 / d;
+        double del = d * c;
+        h *= del;
+        if (fabs(del - 1) < 1e-12) break;
+    }
+    return exp(-x + a * log(x) - gln) * h;
+}
+
+// Тест пар значений (Westfeld–Pfitzmann): p близко к 1, если LSB выровняли пары 2k/2k+1
+static double chiSquareP(const uint64_t hist[256]) {
+    double chi = 0;
+    int pairs = 0;
+    for (int i = 0; i < 128; ++i) {
+        double expected = (hist[2 * i] + hist[2 * i + 1]) / 2.0;
+        if (expected < 1) continue;
+        double d = hist[2 * i] - expected;
+        chi += d * d / expected;
+        ++pairs;
+    }
+    if (pairs < 2) return 0.0;
+    return gammaQ((pairs - 1) / 2.0, chi / 2.0);
+}
+
+// Гистограмма каналов строки в четыре подгистограммы: соседние инкременты не
+// зависят друг от друга по памяти, что убирает store-to-load задержки на
+// повторяющихся значениях; для плотных раскладок строка идёт сплошным потоком байт
+template <class L>
+static void histogramRow(const unsigned char *row, int width, uint32_t (&h)[4][256]) {
+    if constexpr (L::kBytes == L::kChannels) {
+        size_t n = static_cast<size_t>(width) * L::kBytes, i = 0;
+        for (; i + 4 <= n; i += 4) {
+            ++h[0][row[i]]; ++h[1][row[i + 1]]; ++h[2][row[i + 2]]; ++h[3][row[i + 3]];
+        }
+        for (; i < n; ++i) ++h[0][row[i]];
+    } else {
+        for (int x = 0; x < width; ++x) {
+            const unsigned char *px = row + static_cast<size_t>(x) * L::kBytes;
+            for (int c = 0; c < L::kChannels; ++c) ++h[c][px[L::kOffsets[c]]];
+        }
+    }
+}
+
+// Счётчики RS-анализа: R/S-группы для маски M и -M на исходном изображении
+// и на изображении с инвертированными LSB
+struct RsCounts {
+    uint64_t rm = 0, sm = 0, rn = 0, sn = 0;
+    uint64_t rmInv = 0, smInv = 0, rnInv = 0, snInv = 0;
+    uint64_t groups = 0;
+};
+
+static inline int flipPos(int v) { return v ^ 1; }
+static inline int flipNeg(int v) { return ((v + 1) ^ 1) - 1; }
+static inline int smoothness(int a, int b, int c, int d) { return abs(b - a) + abs(c - b) + abs(d - c); }
+
+static inline void rsGroup(int v0, int v1, int v2, int v3,
+                           uint64_t &r, uint64_t &s, uint64_t &rn, uint64_t &sn) {
+    int f0 = smoothness(v0, v1, v2, v3);
+    int fp = smoothness(v0, flipPos(v1), flipPos(v2), v3);
+    int fn = smoothness(v0, flipNeg(v1), flipNeg(v2), v3);
+    r += fp > f0; s += fp < f0;
+    rn += fn > f0; sn += fn < f0;
+}
+
+// Группы из 4 соседних пикселей строки по каждому каналу, маска [0 1 1 0]
+template <class L>
+static void rsRow(const unsigned char *row, int width, RsCounts &rs) {
+    for (int c = 0; c < L::kChannels; ++c) {
+        const unsigned char *p = row + L::kOffsets[c];
+        for (int x = 0; x + 4 <= width; x += 4) {
+            int v0 = p[x * L::kBytes], v1 = p[(x + 1) * L::kBytes];
+            int v2 = p[(x + 2) * L::kBytes], v3 = p[(x + 3) * L::kBytes];
+            rsGroup(v0, v1, v2, v3, rs.rm, rs.sm, rs.rn, rs.sn);
+            rsGroup(v0 ^ 1, v1 ^ 1, v2 ^ 1, v3 ^ 1, rs.rmInv, rs.smInv, rs.rnInv, rs.snInv);
+            ++rs.groups;
+        }
+    }
+}
+
+// Оценка доли внедрения по RS (Fridrich, Goljan, Du): корень квадратного уравнения
+// по разностям R-S на исходном и инвертированном изображении
+static double rsEstimate(const RsCounts &rs) {
+    if (rs.groups == 0) return 0.0;
+    double g = static_cast<double>(rs.groups);
+    double d0 = (double(rs.rm) - double(rs.sm)) / g;
+    double d1 = (double(rs.rmInv) - double(rs.smInv)) / g;
+    double dn0 = (double(rs.rn) - double(rs.sn)) / g;
+    double dn1 = (double(rs.rnInv) - double(rs.snInv)) / g;
+    double a = 2 * (d1 + d0), b = dn0 - dn1 - d1 - 3 * d0, c = d0 - dn0;
+    double x;
+    if (fabs(a) < 1e-12) {
+        if (fabs(b) < 1e-12) return 0.0;
+        x = -c / b;
+    } else {
+        double disc = b * b - 4 * a * c;
+        if (disc < 0) disc = 0;
+        double r1 = (-b + sqrt(disc)) / (2 * a), r2 = (-b - sqrt(disc)) / (2 * a);
+        x = fabs(r1) < fabs(r2) ? r1 : r2;
+    }
+    if (fabs(x - 0.5) < 1e-12) return 1.0;
+    double p = x / (x - 0.5);
+    return min(1.0, max(0.0, p));
+}
+
+template <class L>
+static StegoReport analyzeKernel(const BMPImage &img) {
+    StegoReport rep;
+    const int segments = min(img.height, 100);
+    uint64_t hist[256] = {};
+    uint32_t sub[4][256];
+    RsCounts rs;
+    uint64_t slotsPerRow = static_cast<uint64_t>(img.width) * L::kChannels;
+    uint64_t totalSlots = slotsPerRow * static_cast<uint64_t>(img.height);
+    uint64_t lastHighSlots = 0;
+    double p = 0.0;
+
+    // Строки идут сверху вниз, как и встраивание: p-значение на накопленном
+    // префиксе показывает, докуда тянется последовательная запись
+    int y = 0;
+    for (int s = 1; s <= segments; ++s) {
+        int yEnd = static_cast<int>(static_cast<int64_t>(img.height) * s / segments);
+        memset(sub, 0, sizeof(sub));
+        for (; y < yEnd; ++y) {
+            const unsigned char *row = logicalRow(img, y);
+            histogramRow<L>(row, img.width, sub);
+            rsRow<L>(row, img.width, rs);
+        }
+        for (int v = 0; v < 256; ++v) hist[v] += uint64_t(sub[0][v]) + sub[1][v] + sub[2][v] + sub[3][v];
+        p = chiSquareP(hist);
+        if (p >= 0.5) lastHighSlots = slotsPerRow * static_cast<uint64_t>(yEnd);
+    }
+
+    rep.ok = true;
+    rep.chiSquareP = p;
+    rep.chiRate = totalSlots ? double(lastHighSlots) / double(totalSlots) : 0.0;
+    rep.rsRate = rsEstimate(rs);
+    return rep;
+}
+
+StegoReport analyzeImage(const BMPImage &img) {
+    switch (img.layout) {
+    case PixelLayout::Bgr24: return analyzeKernel<LayoutBgr24>(img);
+    case PixelLayout::Bgra32: return analyzeKernel<LayoutBgra32>(img);
+    case PixelLayout::Indexed8: return analyzeKernel<LayoutIndexed8>(img);
+    }
+    return StegoReport{};
+}
+
+vector<StegoReport> analyzeFiles(const vector<string> &paths, unsigned threads) {
+    vector<StegoReport> reports(paths.size());
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+    threads = static_cast<unsigned>(min<size_t>(threads, max<size_t>(paths.size(), 1)));
+
+    atomic<size_t> next{0};
+    auto worker = [&]() {
+        BMPImage img; // буферы переиспользуются между файлами одного потока
+        for (size_t i = next.fetch_add(1); i < paths.size(); i = next.fetch_add(1)) {
+            if (loadBMP(paths[i], img)) reports[i] = analyzeImage(img);
+            reports[i].path = paths[i];
+        }
+    };
+    vector<thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto &th : pool) th.join();
+    return reports;
+}
@@ -0,0 +1,20 @@
+// steganalysis.hpp — обнаружение LSB-встраивания: хи-квадрат (пары значений) и RS-анализ
+
+#pragma once
+#include "bmp.hpp"
+#include <string>
+#include <vector>
+
+struct StegoReport {
+    std::string path;
+    bool ok = false;          // файл загружен и проанализирован
+    double chiSquareP = 0.0;  // p-значение хи-квадрат по всему изображению
+    double chiRate = 0.0;     // доля контейнера (сверху вниз), где p >= 0.5 — оценка для последовательного LSB
+    double rsRate = 0.0;      // доля LSB-слотов с внедрёнными битами по RS-анализу
+};
+
+// Анализ одного загруженного изображения
+StegoReport analyzeImage(const BMPImage &img);
+
+// Параллельный анализ набора файлов; threads == 0 — по числу ядер
+std::vector<StegoReport> analyzeFiles(const std::vector<std::string> &paths, unsigned threads = 0);
@@ -0,0 +1,174 @@
+// stegocrypt.cpp
+
+#include "stegocrypt.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+// Размер порции при потоковом шифровании/расшифровании
+const size_t kStreamChunk = 4096;
+
+void uint32ToBytes(uint32_t val, uint8_t out[4]) {
+    for (int i = 0; i < 4; ++i) out[i] = static_cast<uint8_t>(val >> (24 - 8 * i));
+}
+
+uint32_t bytesToUint32(const uint8_t in[4]) {
+    uint32_t val = 0;
+    for (int i = 0; i < 4; ++i) val = (val << 8) | in[i];
+    return val;
+}
+
+bool parseKeyHex(const string &hex, crypto::Clefia128::Key &key) {
+    if (hex.size() != 32) return false;
+    auto nibble = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+    for (size_t i = 0; i < 16; ++i) {
+        int hi = nibble(hex[2 * i]), lo = nibble(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) return false;
+        key[i] = static_cast<uint8_t>((hi << 4) | lo);
+    }
+    return true;
+}
+
+crypto::Clefia128::Block randomIv() {
+    crypto::Clefia128::Block iv{};
+    random_device rd;
+    for (auto &b : iv) b = static_cast<uint8_t>(rd());
+    return iv;
+}
+
+bool ImageLsbWriter::write(const uint8_t *src, size_t n) {
+    embedBytes(img, bitPos, src, n);
+    bitPos += n * 8;
+    return true;
+}
+
+bool ImageLsbReader::read(uint8_t *dst, size_t n) {
+    extractBytes(img, bitPos, dst, n);
+    bitPos += n * 8;
+    return true;
+}
+
+namespace {
+
+template <class Writer>
+bool embedImpl(Writer &out, const string &payloadPath, const crypto::Clefia128::Key &key,
+               const crypto::Clefia128::Block &iv, string &error) {
+    ifstream in(payloadPath, ios::binary | ios::ate);
+    if (!in) {
+        error = "Не удалось открыть файл с данными.";
+        return false;
+    }
+    uint64_t payloadSize = static_cast<uint64_t>(in.tellg());
+    in.seekg(0, ios::beg);
+
+    size_t capacity = out.capacityBits();
+    if (payloadSize > numeric_limits<uint32_t>::max() ||
+        32 + 128 + payloadSize * 8 > capacity) {
+        error = "Файл слишком большой для данного контейнера (вместимость: " +
+                to_string(capacity > 160 ? (capacity - 160) / 8 : 0) + " байт).";
+        return false;
+    }
+
+    uint8_t lenBytes[4];
+    uint32ToBytes(static_cast<uint32_t>(payloadSize), lenBytes);
+    if (!out.write(lenBytes, 4) || !out.write(iv.data(), iv.size())) {
+        error = "Ошибка записи в контейнер.";
+        return false;
+    }
+
+    crypto::Clefia128Ctr ctr(key, iv);
+    vector<uint8_t> chunk(kStreamChunk);
+    uint64_t left = payloadSize;
+    while (left > 0) {
+        size_t n = static_cast<size_t>(min<uint64_t>(left, chunk.size()));
+        in.read(reinterpret_cast<char*>(chunk.data()), static_cast<streamsize>(n));
+        if (!in) {
+            error = "Ошибка чтения файла с данными.";
+            return false;
+        }
+        ctr.apply(chunk.data(), n);
+        if (!out.write(chunk.data(), n)) {
+            error = "Ошибка записи в контейнер.";
+            return false;
+        }
+        left -= n;
+    }
+    return true;
+}
+
+template <class Reader>
+bool extractImpl(Reader &in, const string &outPath, const crypto::Clefia128::Key &key, string &error) {
+    size_t capacity = in.capacityBits();
+    uint8_t lenBytes[4];
+    crypto::Clefia128::Block iv{};
+    if (capacity < 32 + 128 || !in.read(lenBytes, 4) || !in.read(iv.data(), iv.size())) {
+        error = "Недостаточно данных для чтения заголовка.";
+        return false;
+    }
+    uint32_t payloadSize = bytesToUint32(lenBytes);
+    if (32 + 128 + static_cast<uint64_t>(payloadSize) * 8 > capacity) {
+        error = "Недостаточно данных для извлечения полного файла.";
+        return false;
+    }
+
+    ofstream out(outPath, ios::binary);
+    if (!out) {
+        error = "Не удалось открыть выходной файл.";
+        return false;
+    }
+    // Частично расшифрованный файл не оставляем
+    auto fail = [&](const char *msg) {
+        error = msg;
+        out.close();
+        remove(outPath.c_str());
+        return false;
+    };
+    crypto::Clefia128Ctr ctr(key, iv);
+    vector<uint8_t> chunk(kStreamChunk);
+    uint64_t left = payloadSize;
+    while (left > 0) {
+        size_t n = static_cast<size_t>(min<uint64_t>(left, chunk.size()));
+        if (!in.read(chunk.data(), n)) return fail("Ошибка чтения контейнера.");
+        ctr.apply(chunk.data(), n);
+        out.write(reinterpret_cast<const char*>(chunk.data()), static_cast<streamsize>(n));
+        if (!out) return fail("Ошибка записи выходного файла.");
+        left -= n;
+    }
+    out.close();
+    if (!out) return fail("Ошибка записи выходного файла.");
+    return true;
+}
+
+} // namespace
+
+bool embedEncryptedFile(ImageLsbWriter &out, const string &payloadPath,
+                        const crypto::Clefia128::Key &key, const crypto::Clefia128::Block &iv,
+                        string &error) {
+    return embedImpl(out, payloadPath, key, iv, error);
+}
+
+bool embedEncryptedFile(BMPStreamWriter &out, const string &payloadPath,
+                        const crypto::Clefia128::Key &key, const crypto::Clefia128::Block &iv,
+                        string &error) {
+    return embedImpl(out, payloadPath, key, iv, error);
+}
+
+bool extractEncryptedFile(ImageLsbReader &in, const string &outPath,
+                          const crypto::Clefia128::Key &key, string &error) {
+    return extractImpl(in, outPath, key, error);
+}
+
+bool extractEncryptedFile(BMPStreamReader &in, const string &outPath,
+                          const crypto::Clefia128::Key &key, string &error) {
+    return extractImpl(in, outPath, key, error);
+}
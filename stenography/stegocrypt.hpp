@@ -0,0 +1,54 @@
+// stegocrypt.hpp — файл, зашифрованный CLEFIA-128 CTR, в LSB-потоке контейнера
+//
+// Поток бит: [32 бита длины в байтах] + [16 байт IV] + [шифртекст]. Шифрование
+// и расшифрование идут порциями прямо в LSB и из LSB, промежуточный файл не нужен.
+// Для загруженного изображения и для потокового режима формат один и тот же.
+
+#pragma once
+#include "bmp.hpp"
+#include "bmpstream.hpp"
+#include "crypto/clefia.hpp"
+#include <cstdint>
+#include <string>
+
+// Упаковка 32-битной длины в 4 байта (big-endian) и обратно
+void uint32ToBytes(uint32_t val, uint8_t out[4]);
+uint32_t bytesToUint32(const uint8_t in[4]);
+
+// Разбор 128-битного ключа из 32 hex-символов
+bool parseKeyHex(const std::string &hex, crypto::Clefia128::Key &key);
+
+// Случайный IV из std::random_device
+crypto::Clefia128::Block randomIv();
+
+// Последовательная запись/чтение LSB загруженного изображения; тот же интерфейс,
+// что у потоковых BMPStreamWriter/BMPStreamReader
+struct ImageLsbWriter {
+    BMPImage &img;
+    size_t bitPos = 0;
+
+    size_t capacityBits() const { return ::capacityBits(img); }
+    bool write(const uint8_t *src, size_t n);
+};
+
+struct ImageLsbReader {
+    const BMPImage &img;
+    size_t bitPos = 0;
+
+    size_t capacityBits() const { return ::capacityBits(img); }
+    bool read(uint8_t *dst, size_t n);
+};
+
+// Шифрование файла payloadPath с одновременной записью в LSB с начала потока
+bool embedEncryptedFile(ImageLsbWriter &out, const std::string &payloadPath,
+                        const crypto::Clefia128::Key &key, const crypto::Clefia128::Block &iv,
+                        std::string &error);
+bool embedEncryptedFile(BMPStreamWriter &out, const std::string &payloadPath,
+                        const crypto::Clefia128::Key &key, const crypto::Clefia128::Block &iv,
+                        std::string &error);
+
+// Извлечение с расшифрованием на лету в outPath; при ошибке выходной файл удаляется
+bool extractEncryptedFile(ImageLsbReader &in, const std::string &outPath,
+                          const crypto::Clefia128::Key &key, std::string &error);
+bool extractEncryptedFile(BMPStreamReader &in, const std::string &outPath,
+                          const crypto::Clefia128::Key &key, std::string &error);
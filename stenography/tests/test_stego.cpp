@@ -0,0 +1,312 @@
+// tests/test_stego.cpp
+#include "bmp.hpp"
+#include "bmpstream.hpp"
+#include "multicarrier.hpp"
+#include "steganalysis.hpp"
+#include "stegocrypt.hpp"
+
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+static void putLE(vector<uint8_t> &v, uint64_t x, int bytes) {
+    for (int i = 0; i < bytes; ++i) v.push_back(static_cast<uint8_t>(x >> (8 * i)));
+}
+
+// Синтетический BMP: BITMAPINFOHEADER (или V5 с масками BGRA для 32 бит),
+// палитра градаций серого для 8 бит, пиксели из rng и хвост trailer байт
+static vector<uint8_t> makeBMP(int width, int height, int bpp, bool v5, size_t trailer, mt19937 &rng) {
+    uint32_t infoSize = v5 ? 124 : 40;
+    uint32_t paletteBytes = bpp == 8 ? 256 * 4 : 0;
+    uint32_t offset = 14 + infoSize + paletteBytes;
+    size_t stride = (static_cast<size_t>(width) * bpp / 8 + 3) & ~size_t(3);
+    size_t h = static_cast<size_t>(height < 0 ? -height : height);
+    size_t dataSize = stride * h;
+
+    vector<uint8_t> f;
+    f.push_back('B'); f.push_back('M');
+    putLE(f, offset + dataSize + trailer, 4);
+    putLE(f, 0, 4);
+    putLE(f, offset, 4);
+    putLE(f, infoSize, 4);
+    putLE(f, static_cast<uint32_t>(width), 4);
+    putLE(f, static_cast<uint32_t>(height), 4);
+    putLE(f, 1, 2);
+    putLE(f, static_cast<uint32_t>(bpp), 2);
+    putLE(f, v5 ? 3 : 0, 4);            // BI_BITFIELDS у V5, иначе BI_RGB
+    putLE(f, dataSize, 4);
+    putLE(f, 2835, 4); putLE(f, 2835, 4);
+    putLE(f, bpp == 8 ? 256 : 0, 4);
+    putLE(f, 0, 4);
+    if (v5) {
+        putLE(f, 0x00FF0000u, 4); putLE(f, 0x0000FF00u, 4); putLE(f, 0x000000FFu, 4); putLE(f, 0xFF000000u, 4);
+        while (f.size() < 14 + infoSize) f.push_back(0);
+    }
+    for (uint32_t i = 0; i < paletteBytes / 4; ++i) {
+        f.push_back(static_cast<uint8_t>(i)); f.push_back(static_cast<uint8_t>(i));
+        f.push_back(static_cast<uint8_t>(i)); f.push_back(0);
+    }
+    for (size_t i = 0; i < dataSize + trailer; ++i) f.push_back(static_cast<uint8_t>(rng()));
+    return f;
+}
+
+static void writeFile(const string &path, const vector<uint8_t> &data) {
+    ofstream f(path, ios::binary);
+    f.write(reinterpret_cast<const char*>(data.data()), static_cast<streamsize>(data.size()));
+}
+
+static vector<uint8_t> readFile(const string &path) {
+    ifstream f(path, ios::binary);
+    return vector<uint8_t>(istreambuf_iterator<char>(f), istreambuf_iterator<char>());
+}
+
+static vector<uint8_t> randomBytes(size_t n, mt19937 &rng) {
+    vector<uint8_t> v(n);
+    for (auto &b : v) b = static_cast<uint8_t>(rng());
+    return v;
+}
+
+int main() {
+    mt19937 rng(20240611);
+    const string dir = (fs::temp_directory_path() / "test_stego").string();
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    // 1) Потоковый режим: результат совпадает с обычным, извлечение возвращает данные
+    {
+        // 24 бит 1200x400: ~1.4 МБ пикселей, то есть несколько полос
+        const string in = dir + "/big.bmp", out = dir + "/big_out.bmp", mem = dir + "/big_mem.bmp";
+        writeFile(in, makeBMP(1200, 400, 24, false, 0, rng));
+        vector<uint8_t> payload = randomBytes(150000, rng);
+
+        BMPStreamWriter writer;
+        assert(writer.open(in, out));
+        for (size_t off = 0; off < payload.size(); off += 4096)
+            assert(writer.write(payload.data() + off, min<size_t>(4096, payload.size() - off)));
+        assert(writer.finish());
+
+        BMPImage img;
+        assert(loadBMP(in, img));
+        embedBytes(img, 0, payload.data(), payload.size());
+        assert(saveBMP(mem, img));
+        assert(readFile(out) == readFile(mem) && "streaming embed == in-memory embed");
+
+        BMPStreamReader reader;
+        vector<uint8_t> back(payload.size());
+        assert(reader.open(out) && reader.read(back.data(), back.size()));
+        assert(back == payload);
+
+        // Выход поверх входа: контейнер не обнуляется до чтения
+        const string inplace = dir + "/inplace.bmp";
+        fs::copy_file(in, inplace);
+        {
+            BMPStreamWriter w;
+            assert(w.open(inplace, inplace));
+            assert(w.write(payload.data(), payload.size()));
+            assert(w.finish());
+        }
+        assert(readFile(inplace) == readFile(mem) && "in-place streaming embed");
+
+        // Неудачное встраивание не оставляет выходного файла
+        const string failed = dir + "/failed.bmp";
+        {
+            BMPStreamWriter w;
+            assert(w.open(in, failed));
+            vector<uint8_t> tooBig(w.capacityBits() / 8 + 1);
+            assert(!w.write(tooBig.data(), tooBig.size()));
+        }
+        assert(!fs::exists(failed) && !fs::exists(failed + ".tmp"));
+        cout << "[OK] BMP streaming\n";
+    }
+
+    // 2) Шифрование с внедрением: режимы 4 и 9 дают один и тот же BMP, оба читателя расшифровывают
+    {
+        // top-down 1200x400: полоса 0 в начале файла, данные занимают и полосу 1
+        const string in = dir + "/carrier.bmp", mem = dir + "/enc_mem.bmp", stream = dir + "/enc_stream.bmp";
+        const string payloadPath = dir + "/secret.bin";
+        writeFile(in, makeBMP(1200, -400, 24, false, 0, rng));
+        vector<uint8_t> payload = randomBytes(150000, rng);
+        writeFile(payloadPath, payload);
+
+        crypto::Clefia128::Key key{};
+        assert(parseKeyHex("000102030405060708090A0B0C0D0E0F", key));
+        assert(!parseKeyHex("000102030405060708090a0b0c0d0e0g", key) && !parseKeyHex("0001", key));
+        const crypto::Clefia128::Block iv = randomIv();
+        string err;
+
+        BMPImage img;
+        assert(loadBMP(in, img));
+        ImageLsbWriter memWriter{img};
+        assert(embedEncryptedFile(memWriter, payloadPath, key, iv, err) && saveBMP(mem, img));
+
+        BMPStreamWriter streamWriter;
+        assert(streamWriter.open(in, stream));
+        assert(embedEncryptedFile(streamWriter, payloadPath, key, iv, err) && streamWriter.finish());
+        assert(readFile(mem) == readFile(stream) && "mode 4 == mode 9");
+
+        // В LSB лежит шифртекст, а не сами данные
+        vector<uint8_t> raw(payload.size());
+        extractBytes(img, 32 + 128, raw.data(), raw.size());
+        assert(raw != payload);
+
+        const string outMem = dir + "/dec_mem.bin", outStream = dir + "/dec_stream.bin";
+        ImageLsbReader memReader{img};
+        assert(extractEncryptedFile(memReader, outMem, key, err) && readFile(outMem) == payload);
+        BMPStreamReader streamReader;
+        assert(streamReader.open(stream) && extractEncryptedFile(streamReader, outStream, key, err));
+        assert(readFile(outStream) == payload);
+
+        // Данные больше контейнера
+        const string big = dir + "/big.bin";
+        writeFile(big, vector<uint8_t>(capacityBits(img) / 8));
+        ImageLsbWriter w{img};
+        assert(!embedEncryptedFile(w, big, key, iv, err));
+
+        // Контейнер обрезан после заголовка: чтение полосы 1 падает, частичный файл удаляется
+        BMPStreamReader broken;
+        assert(broken.open(stream));
+        fs::resize_file(stream, fs::file_size(stream) - 200000);
+        const string partial = dir + "/partial.bin";
+        assert(!extractEncryptedFile(broken, partial, key, err) && err == "Ошибка чтения контейнера.");
+        assert(!fs::exists(partial));
+        cout << "[OK] encrypt-then-embed\n";
+    }
+
+    // 3) BMP: раундтрип load/save и LSB-ядра для всех раскладок, допустимые размеры заголовка
+    {
+        struct Variant { int w, h, bpp; bool v5; size_t trailer; PixelLayout layout; };
+        const Variant variants[] = {
+            {33, 20, 24, false, 0, PixelLayout::Bgr24},     // bottom-up, паддинг строк
+            {33, -20, 24, false, 0, PixelLayout::Bgr24},    // top-down
+            {61, 40, 32, true, 16, PixelLayout::Bgra32},    // V5 с масками и хвостом
+            {100, 50, 8, false, 0, PixelLayout::Indexed8},  // палитра
+        };
+        const string path = dir + "/variant.bmp", out = dir + "/variant_out.bmp";
+        for (const auto &v : variants) {
+            vector<uint8_t> file = makeBMP(v.w, v.h, v.bpp, v.v5, v.trailer, rng);
+            writeFile(path, file);
+            BMPImage img;
+            assert(loadBMP(path, img));
+            assert(img.layout == v.layout && img.width == v.w && img.topDown == (v.h < 0));
+            assert(saveBMP(out, img) && readFile(out) == file && "save keeps the file byte-identical");
+
+            vector<uint8_t> msg = randomBytes(capacityBits(img) / 8 - 1, rng), back(msg.size());
+            embedBytes(img, 3, msg.data(), msg.size());
+            extractBytes(img, 3, back.data(), back.size());
+            assert(back == msg);
+        }
+        BMPImage gray;
+        assert(loadBMP(path, gray) && paletteLsbDelta(gray) == 1);
+
+        // Заголовок BITMAPINFOHEADER, дополненный нулями до infoSize байт
+        auto withInfoSize = [&](uint32_t infoSize) {
+            vector<uint8_t> f = makeBMP(16, 8, 24, false, 0, rng);
+            f.insert(f.begin() + 14 + 40, infoSize - 40, 0);
+            auto put32 = [&](size_t at, uint32_t x) { for (int i = 0; i < 4; ++i) f[at + i] = static_cast<uint8_t>(x >> (8 * i)); };
+            put32(2, static_cast<uint32_t>(f.size()));
+            put32(10, 14 + infoSize);
+            put32(14, infoSize);
+            return f;
+        };
+        for (uint32_t infoSize : {52u, 56u, 108u, 124u, 64u, 48u}) {
+            writeFile(path, withInfoSize(infoSize));
+            BMPImage img;
+            bool known = infoSize != 64 && infoSize != 48;   // 64 — OS/2 2.x
+            assert(loadBMP(path, img) == known);
+        }
+        cout << "[OK] BMP variants\n";
+    }
+
+    // 4) Стегоанализ: хи-квадрат на контейнере с чётными значениями, RS-анализ на гладком lena.bmp
+    {
+        const string path = dir + "/even.bmp";
+        vector<uint8_t> file = makeBMP(256, 256, 24, false, 0, rng);
+        for (size_t i = 14 + 40; i < file.size(); ++i) file[i] &= 0xFE;
+        writeFile(path, file);
+
+        BMPImage img;
+        assert(loadBMP(path, img));
+        StegoReport clean = analyzeImage(img);
+        vector<uint8_t> noise = randomBytes(capacityBits(img) / 8, rng);
+        embedBytes(img, 0, noise.data(), noise.size());
+        StegoReport full = analyzeImage(img);
+        assert(clean.ok && full.ok);
+        assert(full.chiRate > 0.9 && clean.chiRate < 0.1);
+
+        // RS нужен гладкий контейнер: на шуме группы не отличаются от флипнутых
+        const string lena = (fs::path(__FILE__).parent_path().parent_path() / "test_files" / "lena.bmp").string();
+        BMPImage smooth;
+        assert(loadBMP(lena, smooth) && "run from the stenography directory");
+        StegoReport lenaClean = analyzeImage(smooth);
+        vector<uint8_t> half = randomBytes(capacityBits(smooth) / 16, rng);
+        embedBytes(smooth, 0, half.data(), half.size());
+        StegoReport lenaHalf = analyzeImage(smooth);
+        assert(lenaClean.rsRate < 0.1);                            // ~0.04
+        assert(lenaHalf.rsRate > 0.4 && lenaHalf.rsRate < 0.65);   // ~0.53
+
+        vector<StegoReport> reports = analyzeFiles({path, lena, dir + "/missing.bmp"}, 2);
+        assert(reports.size() == 3 && reports[0].ok && reports[1].ok && !reports[2].ok);
+        assert(reports[1].rsRate == lenaClean.rsRate && reports[1].chiRate == lenaClean.chiRate);
+        cout << "[OK] steganalysis\n";
+    }
+
+    // 5) Несколько контейнеров: пропорциональный план, сборка и отказ на несогласованных наборах
+    {
+        const string carriers = dir + "/carriers", outDir = dir + "/frags/nested";  // outDir ещё не существует
+        fs::create_directories(carriers);
+        vector<string> paths;
+        const int sizes[][2] = {{200, 100}, {100, 100}, {64, 50}};
+        for (size_t i = 0; i < 3; ++i) {
+            paths.push_back(carriers + "/c" + to_string(i) + ".bmp");
+            writeFile(paths.back(), makeBMP(sizes[i][0], sizes[i][1], 24, false, 0, rng));
+        }
+        const string payloadPath = dir + "/payload.bin", assembled = dir + "/assembled.bin";
+        vector<uint8_t> payload = randomBytes(8000, rng);
+        writeFile(payloadPath, payload);
+
+        vector<FragmentPlan> plan;
+        string err;
+        assert(planFragments(paths, outDir, payload.size(), plan, err));
+        assert(plan.size() == 3);
+        assert(plan[0].header.size > plan[1].header.size && plan[1].header.size > plan[2].header.size);
+        assert(embedFragments(plan, payloadPath, err));
+
+        // Порядок файлов не важен, посторонний BMP игнорируется
+        vector<string> outs = {plan[2].output, paths[0], plan[0].output, plan[1].output};
+        assert(assembleFragments(outs, assembled, err) && readFile(assembled) == payload);
+
+        // Перекрывающиеся участки и расходящийся totalSize отвергаются, файл не создаётся
+        vector<FragmentPlan> bad = plan;
+        bad[1].header.offset -= 1;
+        assert(embedFragments(bad, payloadPath, err));
+        fs::remove(assembled);
+        assert(!assembleFragments({bad[0].output, bad[1].output, bad[2].output}, assembled, err));
+        assert(!fs::exists(assembled));
+
+        bad = plan;
+        bad[2].header.totalSize += 1;
+        assert(embedFragments(bad, payloadPath, err));
+        assert(!assembleFragments({bad[0].output, bad[1].output, bad[2].output}, assembled, err));
+        assert(!fs::exists(assembled));
+
+        // Ошибка на последнем контейнере: уже записанные фрагменты удаляются
+        const string rollback = dir + "/rollback";
+        assert(planFragments(paths, rollback, payload.size(), plan, err));
+        bad = plan;
+        bad[2].carrier = carriers + "/missing.bmp";
+        assert(!embedFragments(bad, payloadPath, err, 1));
+        assert(fs::is_empty(rollback));
+        cout << "[OK] multi-carrier\n";
+    }
+
+    fs::remove_all(dir);
+    cout << "All tests passed.\n";
+    return 0;
+}